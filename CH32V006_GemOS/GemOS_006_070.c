@@ -1,11 +1,106 @@
 /*********************************************************************************
  * Project Name : GemOS (CH32V006 Port)
- * Version      : 0.70
- * Date         : 2026-05-02
+ * Version      : 0.95
+ * Date         : 2026-10-16
  * Target MCU   : WCH CH32V006F8P6 (TSSOP20)
  * Developers   : yas & Gemini
  *
  * [Change History]
+ * V0.95 - Pre-decode reads the first slot's code blocks as one sequential
+ * stream and decodes only the starts a backward branch adds, so launch stays
+ * within the EEPROM burst, and carts of more slots are pre-decoded too while
+ * their code fits the first slot and VM_REC_MAX. Packed format 2 stores the
+ * blocks in block order, a repeated block as a reference to its first copy.
+ * V0.94 - VM snapshot (VM_SNAP): EXT in the app bar writes vars, sprites,
+ * rects, map, PC and return stack to EEPROM 0x0480 with page writes, and the
+ * next launch of that slot streams them back instead of starting at PC 0.
+ * A stamp of the cartridge and a body CRC send stale snapshots to a cold
+ * start. END quits without one; the launcher marks the slot with '*'.
+ * V0.93 - Packed cartridges: a slot starting with DEV_PACK_MAGIC holds its
+ * command blocks as LZ token streams behind an offset table (pc_upload.py
+ * --pack), expanded by vm_unpack() from one sequential EEPROM read straight
+ * into the cache page. Pre-decode walks a worklist instead of sweeping, and
+ * the V command reports EEPROM bytes read at launch.
+ * V0.92 - Per-page display list: vm_run_frame() buckets sprites, rects and
+ * numbers into one bitmask per OLED page (vm_dl_build), so each of the 8
+ * render_vm_page() passes visits only the objects on that page and the one
+ * tilemap row it covers.
+ * V0.91 - Demand-paged code cache: vm_memory (a 2 KB slot copy) is replaced by
+ * 24 pages of one command block each, read from the EEPROM on first use with a
+ * clock replacement policy. A cartridge may continue into up to 3 following
+ * slots with ID 0xFE. Dashboard shows hit rate and refills per frame.
+ * V0.90 - Input record/replay (IN_REC): joystick, cursor and buttons are
+ * sampled once per frame, and the RANDOM seed is kept in vm_rng_seed. I,R and
+ * I,P arm a recording or a replay for the next app launch, I lists the log as
+ * I,L lines that load it back.
+ * V0.89 - Sound sequencer on the TIM1 update interrupt (1 kHz): OpCode 0x91
+ * MELODY queues the notes of a command block, BEEP lengths are timed by the
+ * interrupt too, so sound_update() is gone from the main loop.
+ * V0.88 - Frame time breakdown (FT_PROF): SysTick time charged to input,
+ * serial, VM, render, OLED transfer, EEPROM, sound and idle each main loop
+ * pass, min/avg/max over 32-frame windows. M terminal command and a PERF
+ * overlay toggled from the SYS menu. FT_PROF 0 compiles it all out.
+ * V0.87 - Interrupt-driven terminal: USART1_IRQHandler serves a 64-byte RX ring
+ * and a 128-byte TX ring. check_serial() assembles lines without blocking and
+ * also runs during apps; D/R listings are paced by TX ring space. Launcher
+ * caches only the 4 visible slot titles.
+ * V0.86 - Binary bulk-upload link: a 0xA5 byte in PC LINK mode starts
+ * link_session(), CRC-16 frames of up to 64 bytes written by page with
+ * cumulative ACK / go-back-N NAK, CLOSE returns a CRC of the written range.
+ * pc_upload.py streams whole slot images.
+ * V0.85 - EEPROM page writes with ACK polling: S/W/F/V uploads use one write
+ * cycle per page (eeprom_write_block) instead of one 5 ms cycle per byte; serial
+ * input is buffered in a 64-byte ring while the bus is busy.
+ * V0.84 - eeprom_read_block() sequential reads for font_cache, slot titles,
+ * cartridge launch and the R/D commands; V command reports boot and launch load
+ * times against the old per-byte path.
+ * V0.83 - OLED pages over I2C1 + DMA1_CH6 (400 kHz) while the next page renders;
+ * PC1/PC2 switch back to soft I2C for every EEPROM transaction. Falls back to
+ * soft I2C on a bus fault. Dashboard shows bus kB/s and DMA wait per frame.
+ * V0.82 - Column blitter: draw_char, 0x19 bitmap sprites and tiles OR whole
+ * 8-pixel page columns (shift-and-split for non-aligned Y) instead of per-pixel
+ * draw_pixel; invert_rect XORs one column mask.
+ * V0.81 - OLED page diff: each page is rendered as before but only sent over I2C
+ * when its signature changed (forced full refresh every 64 frames). Dashboard
+ * shows display time and pages per frame.
+ * V0.80 - Broadphase OpCode 0x90 RECT_FIND: tests a point or box against all 64
+ * vm_rects through 16 px column/row band masks kept up to date by
+ * 0x14/0x15/0x17.
+ * V0.79 - 16-bit pair OpCodes 0x86-0x8C, var-to-var compare-and-branch
+ * 0x8D JCMP and indirect LOADI/STOREI 0x8E/0x8F. 0x1B draws a pair when the
+ * var byte has bit 7 set. Branch test no longer shifts by handler ids >= 32.
+ * V0.78 - Ray-scan OpCodes 0x84 RAY_SCAN / 0x85 RAY_FLIP: count (and optionally
+ * flip) the opposing run in one direction with 16x16 map bounds checks in the
+ * handler.
+ * V0.77 - Bulk tilemap OpCodes in a new extended range 0x80+: MAP_FILL,
+ * MAP_COUNT, MAP_COPY and MAP_FIND on a clipped rectangle of vm_map, each one
+ * native loop.
+ * V0.76 - CALL (0x1E addr16) and RET (0x1F) with an 8-entry return stack.
+ * Overflow/underflow stop the app and are reported by the T command and the
+ * dashboard. Pre-decode treats CALL as a branch that falls through and RET as a
+ * dead end.
+ * V0.75 - Per-block profiler (VM_PROF): 16-bit hit counters per command block,
+ * halved together on overflow, and the P terminal command printing the hottest
+ * blocks sorted with labels.
+ * V0.74 - Time-budgeted VM frame scheduler: each frame runs until a SysTick
+ * budget (VM_BUDGET_US) is spent instead of a fixed 100 instructions, main loop
+ * paced to VM_FRAME_HZ, ops/frame min/avg/max and budget-hit count on the
+ * dashboard. VM_SCHED_TIME 0 keeps the old op cap.
+ * V0.73 - HOST RUNNER SUPPORT: Split the app launch (vm_launch), VM page
+ * rendering (render_vm_page), cursor movement (cursor_move) and font loading
+ * (font_load) out of main()/setup() so host/gemos_run.c can run slots headless
+ * on a PC. Added vm_frame_ops / vm_frame_capped per-frame statistics. GEMOS_HOST
+ * builds use a RAM image as EEPROM.
+ * V0.72 - PRE-DECODE UPDATE: App launch now runs vm_predecode(), turning the
+ * command area into fixed 8-byte records (vm_recs) with pre-masked operands and
+ * branch targets resolved to record indices. The frame pass executes records
+ * directly. Apps over VM_REC_MAX records fall back to per-step decoding.
+ * Dashboard shows decoded record usage.
+ * V0.71 - VM DISPATCH UPDATE: Moved the VM interpreter out of main() into
+ * vm_run_frame(). OpCodes are now dispatched through a 32-entry handler table
+ * (vm_op_table) and each handler returns its own PC advance, so late OpCodes no
+ * longer walk the whole if/else chain. Added SysTick per-opcode cycle benchmark
+ * (VM_BENCH) and the B terminal command.
  * V0.70 - VM ENGINE FIX: Removed the temporary band-aid code that overwrote the 
  * 9-byte payload headers with 0x20 spaces during app load. Restored correct OS 
  * memory integrity.
@@ -44,6 +139,11 @@
 #define SOFT_SCL 2  // PC2
 #define OLED_ADDR 0x78
 #define EEPROM_ADDR 0x50
+#define EEPROM_PAGE 128     // 24LC512 write page
+#define EEPROM_POLL_MAX 1000 // ACK polls (~15 us each) before a write is given up on
+#define RX_BUF_LEN 64       // USART1 RX ring, filled by USART1_IRQHandler (power of 2)
+#define TX_BUF_LEN 128      // USART1 TX ring, drained by USART1_IRQHandler (power of 2)
+#define TERM_LINE_LEN 72    // Longest terminal line (S with 22 payload bytes is 64)
 #define DEADZONE 300
 
 #define DEV_MEM_START 0x0800
@@ -54,6 +154,117 @@
 #define DEV_CMD_OFS   0x00A0
 #define DEV_DATA_OFS  0x0120
 #define DEV_PAYLD_OFS 0x0220
+#define DEV_ID_CONT   0xFE    // Slot ID: more command blocks of the cartridge in the slot before
+#define DEV_PACK_MAGIC 0x9C   // Byte at DEV_CMD_OFS of a packed slot (never a label character)
+#define DEV_PACK_VER  0x02    // Packed format version, follows the magic
+#define DEV_PACK_DUP  0xFF    // First byte of a block entry that repeats an earlier block
+#define DEV_PACK_HDR  3       // Magic, version, block count; then a 16-bit offset per block
+
+#define VM_OP_COUNT   32      // Base OpCodes 0x00-0x1F
+#define VM_EXT_BASE   0x80    // Extended OpCodes 0x80.. (never ASCII, never erased 0xFF)
+#define VM_EXT_COUNT  18
+#define VM_H_COUNT    (VM_OP_COUNT + VM_EXT_COUNT)   // Handler table size
+#define VM_REC_MAX    320     // Decoded instruction records (8 bytes each)
+#define VM_PC_LIMIT   (DEV_MEM_SIZE - DEV_CMD_OFS - 6)   // One slot (pre-decode bitmap)
+#ifndef VM_BENCH
+#define VM_BENCH      0       // 1 = Per-opcode SysTick cycle counters (B command)
+#endif
+#ifndef VM_PROF
+#define VM_PROF       0       // 1 = Per-block instruction counters (P command)
+#endif
+#define VM_BLOCKS     59      // 32-byte command blocks per slot
+#define TICK_CYCLES   8       // SysTick runs at HCLK/8 (Delay_Init default)
+#define HCLK_MHZ      48
+#define TICKS_PER_US  (HCLK_MHZ / TICK_CYCLES)
+
+/* --- Code Cache --- */
+#define VM_PAGE       32      // Cache page = one command block
+#define VM_CACHE_PAGES 24     // Resident pages (768 B instead of a 2 KB slot copy, max 32)
+#define VM_SPAN_MAX   4       // Slots one cartridge may span (first + DEV_ID_CONT slots)
+#define VM_NO_FRAME   0xFF    // Block not resident / frame free
+
+/* --- Frame Scheduler --- */
+#ifndef VM_SCHED_TIME
+#define VM_SCHED_TIME 0       // 1 = SysTick budget + frame pacing (not yet tuned on hardware), 0 = 100-op cap
+#endif
+#define VM_FRAME_HZ   30      // Target frame rate held by the main loop
+#define VM_BUDGET_US  2000    // VM time per frame before it is cut
+#if VM_SCHED_TIME
+#define VM_OP_LIMIT   2000    // Safety cap on top of the time budget
+#else
+#define VM_OP_LIMIT   100
+#endif
+#define VM_FRAME_TICKS (1000000UL / VM_FRAME_HZ * TICKS_PER_US)
+
+/* --- OLED Page Diff --- */
+#define OLED_DIFF     1       // 1 = Send only pages that changed since the last frame
+#define OLED_REFRESH  64      // Frames between forced full refreshes
+
+/* --- OLED Transport --- */
+#ifndef OLED_HW_I2C
+#define OLED_HW_I2C   0       // 1 = OLED pages via I2C1 + DMA1_CH6 (not yet verified on a board), 0 = soft I2C only
+#endif
+#define I2C_HW_KHZ    400     // I2C1 SCL (fast mode, 400..1000)
+#define I2C_HW_TIMEOUT 100000UL // Wait loops before falling back to soft I2C
+#define OLED_TX_LEN   (7 + 128) // Position commands + control byte + page
+
+/* --- Sound Sequencer --- */
+#define SND_TICK_HZ   1000    // TIM1 update rate; note lengths are counted in these ticks
+#define SND_Q_LEN     8       // Queued MELODY blocks (power of 2)
+#define SND_LOOP      0xFF    // Note byte: restart the block
+#define SND_BEEP_MS   33      // BEEP length unit (one frame at the original 30 fps), paced or not
+
+/* --- Frame Time Breakdown --- */
+#ifndef FT_PROF
+#define FT_PROF       0       // 1 = SysTick time per main loop phase (M command, PERF overlay)
+#endif
+#define FT_WINDOW     32      // Frames per rolling min/avg/max window
+#define FT_INPUT      0       // ADC, cursor and anything not listed below
+#define FT_SERIAL     1       // check_serial(), link_session()
+#define FT_VM         2       // vm_run_frame()
+#define FT_RENDER     3       // 8-page loop without OLED and EEPROM time
+#define FT_OLED       4       // oled_send_page(): diff, soft I2C or DMA wait
+#define FT_EEPROM     5       // 24LC512 transactions including ACK polling
+#define FT_IDLE       6       // Frame pacing wait
+#define FT_PHASES     7
+#if FT_PROF
+#define SYS_MENU_END  47      // SYS pull-down: I/O TEST, PC LINK, PERF
+#else
+#define SYS_MENU_END  36
+#endif
+
+/* --- Input Record / Replay --- */
+#ifndef IN_REC
+#define IN_REC        0       // 1 = Per-frame input log for repeatable runs (I command)
+#endif
+#define IN_RUNS       48      // Logged runs of identical frames, 4 bytes each
+#define IN_HDR        4       // Log header: slot, RANDOM seed, cursor x, cursor y
+#define IN_LOG_LEN    (IN_HDR + IN_RUNS * 4)
+#define IN_LINE_BYTES 24      // Log bytes per I,L line
+#define IN_OFF        0
+#define IN_REC_ARM    1       // Recording starts at the next app launch
+#define IN_RECORD     2
+#define IN_PLAY_ARM   3       // Replay starts at the next app launch
+#define IN_PLAY       4
+
+/* --- VM Snapshot (suspend / resume) --- */
+#ifndef VM_SNAP
+#define VM_SNAP       1       // 1 = EXT saves the running app, its next launch resumes it
+#endif
+#define SNAP_ADDR     0x0480  // Free EEPROM below the slots, past the Kana font (ends 0x0416)
+#define SNAP_MAGIC    0x5E
+#define SNAP_VER      0x01    // Bump when vm_snap_parts changes
+#define SNAP_HDR      7       // Magic, version, slot, cart stamp (2), body CRC (2)
+
+/* --- Binary Link (bulk upload, pc_upload.py) --- */
+#define LINK_SOF      0xA5    // Frame start byte (never a terminal command)
+#define LINK_OPEN     0x01    // Host: start of an upload
+#define LINK_WRITE    0x02    // Host: addr16 + up to LINK_DATA_MAX bytes
+#define LINK_CLOSE    0x03    // Host: addr16 + len16, ACK carries their CRC
+#define LINK_ACK      0x80    // Device: frames up to seq accepted
+#define LINK_NAK      0x81    // Device: resend from seq
+#define LINK_ERR      0x82    // Device: frame refused, session closed
+#define LINK_DATA_MAX 64      // One frame in flight behind this fits the RX ring
 
 /* --- Helper Macros --- */
 #define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
@@ -66,7 +277,34 @@ uint16_t adc_offset_y = 512;
 bool eeprom_ok = false;
 uint8_t oled_buffer[128]; 
 uint8_t current_page = 0; 
+#if OLED_DIFF
+uint32_t oled_page_sig[8];        // Signature of the page last sent to the panel
+uint8_t oled_page_valid = 0;      // Bit p = oled_page_sig[p] is on the panel
+uint8_t oled_refresh_cnt = 0;
+#endif
+uint32_t oled_stat_frames = 0;    // Display statistics since app launch
+uint32_t oled_stat_pages = 0;     // Pages actually sent over I2C
+uint32_t oled_stat_ticks = 0;     // Render + transfer time
+#if OLED_HW_I2C
+uint8_t oled_tx[OLED_TX_LEN];     // DMA source, so oled_buffer is free for the next page
+bool oled_hw_ok = true;           // Cleared on a bus timeout or NACK (soft I2C from then on)
+bool i2c_hw_active = false;       // PC1/PC2 owned by I2C1 (else GPIO for soft I2C)
+bool oled_dma_busy = false;
+uint32_t oled_dma_t0 = 0;
+uint32_t oled_stat_wait = 0;      // CPU ticks spent waiting for the DMA page
+uint32_t oled_stat_bus_ticks = 0; // Start-to-end time of transfers seen finishing
+uint32_t oled_stat_bus_bytes = 0;
+#endif
 uint8_t font_cache[158][5]; 
+uint32_t boot_load_ticks = 0;     // font_cache + slot titles at boot (V command)
+uint32_t cart_load_ticks = 0;     // Last vm_launch() page-ins and pre-decode
+uint32_t cart_load_bytes = 0;     // EEPROM bytes read by the last vm_launch()
+uint32_t eeprom_rd_bytes = 0;     // EEPROM bytes read since boot (data phase)
+#if VM_SNAP
+uint32_t cart_cold_ticks = 0;     // Last vm_launch() that started at PC 0
+uint32_t cart_resume_ticks = 0;   // Last vm_launch() that resumed a snapshot
+uint32_t snap_save_ticks = 0;     // Last vm_snap_save()
+#endif
 
 uint8_t menu_state = 0;
 uint8_t popup_state = 0;
@@ -74,9 +312,29 @@ uint8_t popup_state = 0;
 uint8_t app_ver_major = 0;
 uint8_t app_ver_minor = 1;
 
-char slot_titles[31][17];
+char slot_titles[4][17];        // Launcher rows list_top_index..+3, read on scroll
+uint8_t slot_titles_top = 0xFF; // list_top_index of slot_titles (0xFF = reload)
 int8_t selected_slot = 0;
-uint16_t sound_timer = 0;
+
+/* --- Sound Sequencer (TIM1 update interrupt) --- */
+typedef struct {
+    uint8_t frame;     // Code cache frame holding the notes (kept while queued)
+    uint8_t unit;      // ms per length step
+} snd_seq_t;
+
+volatile snd_seq_t snd_q[SND_Q_LEN];
+volatile uint8_t snd_q_head = 0;
+volatile uint8_t snd_q_tail = 0;
+volatile bool snd_flush = false;     // Main loop asks the interrupt to stop all music
+volatile uint8_t snd_flush_to = 0;   // snd_q_head at that request (later blocks survive)
+volatile uint16_t snd_beep_ms = 0;   // BEEP playing over the melody
+volatile uint8_t snd_frame = VM_NO_FRAME; // Cache frame being read by the interrupt
+uint8_t snd_start = 0;               // Interrupt only: notes of snd_frame (page offsets)
+uint8_t snd_pos = 0;
+uint8_t snd_end = 0;
+uint8_t snd_unit = 0;
+uint16_t snd_note_ms = 0;            // Left of the current note
+uint16_t snd_note_arr = 0;           // TIM2 period of the current note (0 = rest)
 
 /* --- VM Engine Variables --- */
 bool vm_running = false;
@@ -85,14 +343,237 @@ uint8_t vm_vars[64];
 uint8_t vm_sprites[32][4]; 
 uint8_t vm_rects[64][4];   
 uint8_t vm_map[256];       
-uint8_t vm_memory[DEV_MEM_SIZE]; 
-uint8_t vm_numbers[8][3];
+uint16_t vm_numbers[8][3]; // value, x, y
 uint8_t vm_num_count = 0;
+uint8_t vm_slot = 0;       // Slot of the last vm_launch()
+uint8_t vm_blocks = VM_BLOCKS;        // Command blocks of the cartridge (59 per slot)
+uint16_t vm_pc_limit = VM_PC_LIMIT;   // End of the command area for the per-step path
+
+/* --- VM Code Cache --- */
+/* Command blocks are paged in from the 24LC512 on first use, one 32-byte
+ * sequential read each, with the same 0x20 padding the slot copy had. A
+ * clock hand picks the frame to reuse. vm_frame_of maps every block of a
+ * cartridge of up to VM_SPAN_MAX slots to its frame. */
+uint8_t vm_cache[VM_CACHE_PAGES][VM_PAGE];
+uint8_t vm_cache_blk[VM_CACHE_PAGES];         // Block in each frame (VM_NO_FRAME = free)
+uint8_t vm_frame_of[VM_BLOCKS * VM_SPAN_MAX]; // Frame of each block (VM_NO_FRAME = on EEPROM)
+uint32_t vm_cache_ref = 0;                    // Bit f = frame f used since the hand passed
+uint8_t vm_cache_hand = 0;
+uint32_t vm_cache_lookups = 0;    // Statistics since app launch (after pre-decode)
+uint32_t vm_cache_misses = 0;
+uint32_t vm_cache_ticks = 0;      // Time spent in refills
+uint32_t vm_cache_stalled = 0;    // Frames with at least one refill
+uint16_t vm_cache_fmiss = 0;      // Refills in the running frame
+uint32_t vm_cache_fticks = 0;
+uint16_t vm_cache_fmiss_max = 0;  // Worst frame
+uint32_t vm_cache_fticks_max = 0;
+
+bool vm_packed = false;           // Cartridge is in the packed format (vm_unpack)
+uint8_t vm_pd_blk = VM_NO_FRAME;  // Block the open pre-decode stream delivers next
+
+/* EEPROM address of a command block; block 59 is block 0 of the next slot */
+static inline uint16_t vm_blk_addr(uint8_t blk) {
+    return DEV_MEM_START + (vm_slot + blk / VM_BLOCKS) * DEV_MEM_SIZE + DEV_CMD_OFS + (blk % VM_BLOCKS) * VM_PAGE;
+}
+void vm_blk_load(uint8_t blk, uint8_t *p);
 
 uint16_t vm_trace[16] = {0};
 uint8_t vm_trace_idx = 0;
 uint16_t last_vm_pc = 0;
 
+uint16_t vm_frame_ops = 0;    // Instructions run in the last frame pass
+bool vm_frame_capped = false; // Last frame pass hit the budget (time or op cap)
+
+uint32_t vm_budget_ticks = VM_BUDGET_US * TICKS_PER_US;
+uint32_t vm_stat_frames = 0;  // Ops-per-frame statistics since app launch
+uint32_t vm_stat_ops = 0;
+uint16_t vm_stat_min = 0xFFFF;
+uint16_t vm_stat_max = 0;
+uint32_t vm_stat_capped = 0;
+
+int16_t vm_in_dx = 0;      // Joystick step of the current frame
+int16_t vm_in_dy = 0;
+uint8_t vm_in_btn = 0;     // BUTTON bits of the current frame: A, B, stick switch
+uint8_t vm_rng_seed = 0x55; // RANDOM xorshift state
+#if VM_SNAP
+uint8_t vm_snap_slot = 0xFF;  // Slot of the snapshot at SNAP_ADDR (0xFF = none)
+bool vm_resumed = false;      // Last vm_launch() restored a snapshot
+void vm_snap_drop();
+#endif
+
+#if IN_REC
+uint8_t in_log[IN_LOG_LEN];   // Header, then runs of { frames, dx, dy, buttons }
+uint16_t in_len = 0;          // Bytes of in_log in use
+uint16_t in_pos = 0;          // Replay: offset of the current run
+uint8_t in_run = 0;           // Replay: frames of the current run already fed
+uint16_t in_frames = 0;       // Frames recorded or replayed since the launch
+uint8_t in_mode = IN_OFF;
+bool in_full = false;         // Recording stopped with the log full
+#endif
+
+/* --- VM Decoded Instruction Cache --- */
+/* One fixed-width record per reachable instruction, built at app launch.
+ * 320 records x 8 bytes = 2560 B. OTHELLO V0.34 uses 282 and B_BREAKER V0.30
+ * uses 273 (including link and halt records). */
+typedef struct {
+    uint8_t  h;        // Handler index (OpCode, VM_H_LINK or VM_H_HALT)
+    uint8_t  a;        // Pre-masked operands
+    uint8_t  b;
+    uint8_t  c;
+    uint16_t t;        // Branch target record, or packed wide operand
+    uint16_t pc;       // Source offset in the command area (trace)
+} vm_rec_t;
+
+#define VM_H_NOP      0x00
+#define VM_H_LINK     (VM_H_COUNT + 0)    // Free jump to t (keeps fall-through order)
+#define VM_H_HALT     (VM_H_COUNT + 1)    // PC ran past the command area
+#define VM_BR_MASK    ((1UL << 0x06) | (1UL << 0x07) | (1UL << 0x0C) | (1UL << 0x0D) | (1UL << 0x0E) | (1UL << 0x1A) | (1UL << 0x1E))
+#define VM_H_EXT(op)  (VM_OP_COUNT + ((op) - VM_EXT_BASE))
+#define VM_IS_BRANCH(h) ((h) < VM_OP_COUNT ? ((VM_BR_MASK >> (h)) & 1) : ((h) == VM_H_EXT(0x8D)))
+#define VM_NO_FALL(h) ((h) == 0x06 || (h) == 0x1F)   // JMP and RET never fall through
+
+#define VM_NEXT       0
+#define VM_JUMP       1
+#define VM_YIELD      2
+#define VM_CALL       3
+#define VM_RET        4
+
+/* --- VM Return Stack (CALL 0x1E / RET 0x1F) --- */
+#define VM_CALL_DEPTH 8
+#define VM_FAULT_NONE 0
+#define VM_FAULT_OVF  1       // CALL with a full return stack
+#define VM_FAULT_UNF  2       // RET with an empty return stack
+
+uint16_t vm_call_stack[VM_CALL_DEPTH]; // Return record index (PC on the per-step path)
+uint8_t vm_call_sp = 0;
+uint8_t vm_fault = VM_FAULT_NONE;
+uint16_t vm_fault_pc = 0;
+
+/* --- VM Rect Broadphase (RECT_FIND 0x90) --- */
+/* Bit i of a band mask is set while vm_rects[i] overlaps that band. A query
+ * ANDs the column and row masks it touches, so only rects in the same coarse
+ * grid cells get the exact test. Kept in step by 0x14, 0x15 and 0x17. */
+#define VM_RBAND_X    8       // 16 px columns (x >= 112 shares the last)
+#define VM_RBAND_Y    4       // 16 px rows (y >= 48 shares the last)
+
+uint64_t vm_rband_x[VM_RBAND_X];
+uint64_t vm_rband_y[VM_RBAND_Y];
+
+/* --- VM Display List (render_vm_page) --- */
+/* Built once per VM frame: bit i of a page's mask is set when object i
+ * reaches into that page, so each of the 8 page passes only visits what it
+ * draws. Tilemap row r is page r, so tiles need no list. */
+uint32_t vm_dl_sprites[8];
+uint64_t vm_dl_rects[8];
+uint8_t vm_dl_numbers[8];
+
+vm_rec_t vm_recs[VM_REC_MAX];
+uint16_t vm_rec_count = 0; // 0 = app did not fit, decode per step
+uint16_t vm_ip = 0;        // Current record index
+
+#if VM_BENCH
+uint32_t vm_bench_ticks[VM_H_COUNT];
+uint32_t vm_bench_hits[VM_H_COUNT];
+uint32_t vm_bench_frame_ticks = 0;
+uint32_t vm_bench_frame_ops = 0;
+#endif
+
+#if VM_PROF
+uint16_t vm_prof_hits[VM_BLOCKS]; // Instructions executed per command block
+uint8_t vm_prof_shift = 0;        // Times all counters were halved on overflow
+#endif
+
+/* --- Cycle Counter (SysTick free-run) --- */
+/* Started once in setup() after its last Delay_Ms(), which stops SysTick. */
+void tick_init() {
+    SysTick->CTLR &= ~(1 << 3); 
+    SysTick->CTLR |= (1 << 0); 
+}
+
+static inline uint32_t tick_now() {
+    return SysTick->CNT;
+}
+
+/* --- Frame Time Breakdown --- */
+/* The main loop is always in exactly one phase. Switching charges the ticks
+ * since the last switch to the phase being left, so the phases of a frame
+ * add up to the frame time. EEPROM and OLED code switch in and back out. */
+#if FT_PROF
+uint32_t ft_acc[FT_PHASES];           // Ticks per phase in the running frame
+uint32_t ft_stamp = 0;                // Tick of the last phase switch
+uint8_t ft_cur = FT_INPUT;
+uint32_t ft_sum[FT_PHASES + 1];       // Window sums in us, [FT_PHASES] = whole frame
+uint16_t ft_min[FT_PHASES + 1];
+uint16_t ft_max[FT_PHASES + 1];
+uint8_t ft_win_frames = 0;
+uint16_t ft_rep[FT_PHASES + 1][3];    // Last full window: min, avg, max in us
+bool ft_rep_valid = false;
+bool ft_overlay = false;              // PERF row on the OLED (SYS menu)
+
+/* Enters phase ph and returns the phase that was left */
+static inline uint8_t ft_enter(uint8_t ph) {
+    uint32_t now = tick_now();
+    uint8_t prev = ft_cur;
+    ft_acc[prev] += now - ft_stamp;
+    ft_stamp = now;
+    ft_cur = ph;
+    return prev;
+}
+
+/* Closes a frame (right after the pacing wait) and publishes min/avg/max
+ * every FT_WINDOW frames */
+void ft_frame() {
+    ft_enter(FT_INPUT);
+    uint32_t total = 0;
+    for(uint8_t p = 0; p <= FT_PHASES; p++) {
+        uint32_t t = total;
+        if(p < FT_PHASES) {
+            t = ft_acc[p];
+            ft_acc[p] = 0;
+            total += t;
+        }
+        t /= TICKS_PER_US;
+        uint16_t us = (t > 0xFFFF) ? 0xFFFF : t;
+        if(ft_win_frames == 0) {
+            ft_sum[p] = 0;
+            ft_min[p] = 0xFFFF;
+            ft_max[p] = 0;
+        }
+        ft_sum[p] += us;
+        if(us < ft_min[p]) ft_min[p] = us;
+        if(us > ft_max[p]) ft_max[p] = us;
+    }
+    if(++ft_win_frames >= FT_WINDOW) {
+        for(uint8_t p = 0; p <= FT_PHASES; p++) {
+            ft_rep[p][0] = ft_min[p];
+            ft_rep[p][1] = ft_sum[p] / FT_WINDOW;
+            ft_rep[p][2] = ft_max[p];
+        }
+        ft_win_frames = 0;
+        ft_rep_valid = true;
+    }
+}
+
+/* Drops the time of a pass that ran no frame (PC LINK screen, boot) */
+void ft_discard() {
+    for(uint8_t p = 0; p < FT_PHASES; p++) ft_acc[p] = 0;
+    ft_stamp = tick_now();
+    ft_cur = FT_INPUT;
+}
+
+#define FT_ENTER(ph)  ft_enter(ph)
+#define FT_NEST(ph)   uint8_t ft_prev = ft_enter(ph)
+#define FT_LEAVE()    ft_enter(ft_prev)
+#define FT_FRAME()    ft_frame()
+#define FT_DISCARD()  ft_discard()
+#else
+#define FT_ENTER(ph)
+#define FT_NEST(ph)
+#define FT_LEAVE()
+#define FT_FRAME()
+#define FT_DISCARD()
+#endif
+
 /* --- Software I2C Driver --- */
 void neuron_delay_nop(volatile uint32_t count) { 
     while(count--) {
@@ -100,7 +581,13 @@ void neuron_delay_nop(volatile uint32_t count) {
     }
 }
 
+void i2c_use_soft();
+
 void soft_i2c_start() { 
+#if OLED_HW_I2C
+    i2c_use_soft();
+#endif
+
     GPIOC->BSHR = (1 << SOFT_SDA); 
     neuron_delay_nop(1); 
     GPIOC->BSHR = (1 << SOFT_SCL); 
@@ -119,7 +606,8 @@ void soft_i2c_stop() {
     GPIOC->BSHR = (1 << SOFT_SDA); 
 }
 
-void soft_i2c_write(uint8_t data) { 
+/* Returns true when the slave ACKed the byte */
+bool soft_i2c_write(uint8_t data) { 
     for(int i = 0; i < 8; i++) { 
         if(data & 0x80) {
             GPIOC->BSHR = (1 << SOFT_SDA); 
@@ -136,7 +624,9 @@ void soft_i2c_write(uint8_t data) {
     neuron_delay_nop(1); 
     GPIOC->BSHR = (1 << SOFT_SCL); 
     neuron_delay_nop(1); 
+    bool ack = !(GPIOC->INDR & (1 << SOFT_SDA));
     GPIOC->BSHR = (1 << (SOFT_SCL + 16)); 
+    return ack;
 }
 
 uint8_t soft_i2c_read(bool ack) { 
@@ -167,8 +657,189 @@ uint8_t soft_i2c_read(bool ack) {
     return data; 
 }
 
+/* --- Hardware I2C1 + DMA (OLED pages) --- */
+/* PC1/PC2 are both the soft I2C pins and the I2C1 SDA/SCL pins, so the bus
+ * is switched on demand: OLED pages go out through I2C1 with DMA1_CH6
+ * feeding DATAR, and any soft I2C transaction (EEPROM, oled_cmd) first waits
+ * for the page in flight and hands the pins back to GPIO. The STOP of a page
+ * is sent lazily by oled_dma_wait(), so no interrupt is needed. */
+#if OLED_HW_I2C
+void oled_hw_fault();
+
+void i2c_use_hw() {
+    if(i2c_hw_active) return;
+    GPIOC->CFGLR = (GPIOC->CFGLR & ~(0xFF << 4)) | (0xD << 8) | (0xD << 4); // AF open-drain
+    I2C1->CTLR1 |= (1 << 0);   // PE
+    i2c_hw_active = true;
+}
+
+/* Waits for a STAR1 (star = 1) or STAR2 flag to become set / clear */
+static bool i2c_hw_wait(uint8_t star, uint16_t mask, bool set) {
+    for(uint32_t n = I2C_HW_TIMEOUT; n > 0; n--) {
+        uint16_t st = (star == 1) ? I2C1->STAR1 : I2C1->STAR2;
+        if(((st & mask) != 0) == set) return true;
+        if(I2C1->STAR1 & (1 << 10)) break;   // AF: no ACK from the panel
+    }
+    oled_hw_fault();
+    return false;
+}
+
+/* Finishes the page in flight: DMA done, last byte out (BTF), then STOP */
+void oled_dma_wait() {
+    if(!oled_dma_busy) return;
+    uint32_t t0 = tick_now();
+    bool seen = !(DMA1->INTFR & (1 << 21));  // Still running when we got here
+    for(uint32_t n = I2C_HW_TIMEOUT; !(DMA1->INTFR & (1 << 21)); n--) {
+        if(n == 0) { oled_hw_fault(); return; }
+    }
+    if(!i2c_hw_wait(1, (1 << 2), true)) return;   // BTF
+    I2C1->CTLR1 |= (1 << 9);   // STOP
+    DMA1->INTFCR = (1 << 21);
+    DMA1_Channel6->CFGR &= ~(1 << 0);
+    I2C1->CTLR2 &= ~(1 << 11); // DMAEN
+    oled_dma_busy = false;
+    uint32_t t1 = tick_now();
+    if(seen) {
+        oled_stat_bus_ticks += t1 - oled_dma_t0;
+        oled_stat_bus_bytes += OLED_TX_LEN;
+    }
+    oled_stat_wait += t1 - t0;
+}
+
+void i2c_use_soft() {
+    if(!i2c_hw_active) return;
+    oled_dma_wait();
+    if(!i2c_hw_active) return;   // oled_dma_wait() fell back already
+    i2c_hw_wait(2, (1 << 1), false);   // BUSY: STOP has gone out
+    I2C1->CTLR1 &= ~(1 << 0);
+    GPIOC->BSHR = (1 << SOFT_SDA) | (1 << SOFT_SCL);
+    GPIOC->CFGLR = (GPIOC->CFGLR & ~(0xFF << 4)) | (0x5 << 8) | (0x5 << 4); // GPIO open-drain
+    i2c_hw_active = false;
+}
+
+void oled_hw_fault() {
+    I2C1->CTLR1 |= (1 << 9);
+    DMA1_Channel6->CFGR &= ~(1 << 0);
+    I2C1->CTLR2 &= ~(1 << 11);
+    I2C1->CTLR1 &= ~(1 << 0);
+    oled_dma_busy = false;
+    oled_hw_ok = false;
+    GPIOC->BSHR = (1 << SOFT_SDA) | (1 << SOFT_SCL);
+    GPIOC->CFGLR = (GPIOC->CFGLR & ~(0xFF << 4)) | (0x5 << 8) | (0x5 << 4);
+    i2c_hw_active = false;
+}
+
+void i2c_hw_init() {
+    RCC->PB1PCENR |= RCC_I2C1EN;
+    RCC->AHBPCENR |= RCC_DMA1EN;
+    I2C1->CTLR1 = 0;
+    I2C1->CTLR2 = HCLK_MHZ;   // APB clock in MHz
+    I2C1->CKCFGR = (1 << 15) | (HCLK_MHZ * 1000 / (3 * I2C_HW_KHZ)); // Fast mode, Tlow/Thigh = 2
+    DMA1_Channel6->PADDR = (uint32_t)(uintptr_t)&I2C1->DATAR;
+    DMA1_Channel6->MADDR = (uint32_t)(uintptr_t)oled_tx;
+}
+
+/* Queues current_page: one transaction with the page address commands
+ * (Co = 1 control bytes) followed by the 128 data bytes. Returns while the
+ * DMA is still sending, so the next page renders in parallel. */
+void oled_dma_page() {
+    oled_dma_wait();
+    if(!oled_hw_ok) return;
+    oled_tx[0] = 0x80;
+    oled_tx[1] = 0xB0 + current_page;
+    oled_tx[2] = 0x80;
+    oled_tx[3] = 0x00;
+    oled_tx[4] = 0x80;
+    oled_tx[5] = 0x10;
+    oled_tx[6] = 0x40;
+    memcpy(&oled_tx[7], oled_buffer, 128);
+    i2c_use_hw();
+    if(!i2c_hw_wait(2, (1 << 1), false)) return;  // BUSY
+    DMA1_Channel6->CNTR = OLED_TX_LEN;
+    DMA1_Channel6->CFGR = (1 << 7) | (1 << 4) | (1 << 0);    // MINC, mem -> periph, EN
+    I2C1->CTLR2 |= (1 << 11);  // DMAEN
+    I2C1->CTLR1 |= (1 << 8);   // START
+    if(!i2c_hw_wait(1, (1 << 0), true)) return;   // SB
+    I2C1->DATAR = OLED_ADDR;
+    if(!i2c_hw_wait(1, (1 << 1), true)) return;   // ADDR
+    (void)I2C1->STAR2;         // Clears ADDR, DMA takes over on TXE
+    oled_dma_busy = true;
+    oled_dma_t0 = tick_now();
+}
+#endif
+
 /* --- EEPROM & OLED Driver --- */
+#ifdef GEMOS_HOST
+/* Host build (host/gemos_run.c): the 24LC512 is a RAM image */
+extern uint8_t host_eeprom[0x10000];
+
+uint8_t eeprom_read_byte(uint16_t addr) {
+    eeprom_rd_bytes++;
+    return host_eeprom[addr];
+}
+
+void eeprom_read_block(uint16_t addr, uint8_t *buf, uint16_t len) {
+    eeprom_rd_bytes += len;
+    while(len--) *buf++ = host_eeprom[addr++];
+}
+
+static uint16_t host_stream_addr;
+
+void eeprom_stream_begin(uint16_t addr) {
+    host_stream_addr = addr;
+}
+
+uint8_t eeprom_stream_next() {
+    eeprom_rd_bytes++;
+    return host_eeprom[host_stream_addr++];
+}
+
+void eeprom_stream_end() {
+    eeprom_rd_bytes++;   // The NACKed byte the device reads to end the transfer
+}
+
+void eeprom_write_block(uint16_t addr, const uint8_t *buf, uint16_t len) {
+    while(len--) host_eeprom[addr++] = *buf++;
+}
+
+static uint16_t host_put_addr;
+
+void eeprom_put_begin(uint16_t addr) {
+    host_put_addr = addr;
+}
+
+void eeprom_put(uint8_t b) {
+    host_eeprom[host_put_addr++] = b;
+}
+
+void eeprom_put_end() {
+}
+
+void eeprom_write_byte(uint16_t addr, uint8_t data) {
+    host_eeprom[addr] = data;
+}
+#else
+bool eeprom_busy = false;   // A write cycle may still be running
+
+/* ACK polling: the 24LC512 ignores its address until the internal write
+ * cycle is done. Serial input keeps arriving in the RX ring meanwhile. */
+void eeprom_wait_ready() {
+    if(!eeprom_busy) return;
+    FT_NEST(FT_EEPROM);
+    for(uint16_t n = 0; n < EEPROM_POLL_MAX; n++) {
+        soft_i2c_start(); 
+        bool ack = soft_i2c_write((EEPROM_ADDR << 1) | 0); 
+        soft_i2c_stop(); 
+        if(ack) break;
+    }
+    eeprom_busy = false;
+    FT_LEAVE();
+}
+
 uint8_t eeprom_read_byte(uint16_t addr) { 
+    FT_NEST(FT_EEPROM);
+    eeprom_rd_bytes++;
+    eeprom_wait_ready();
     soft_i2c_start(); 
     soft_i2c_write((EEPROM_ADDR << 1) | 0); 
     soft_i2c_write((uint8_t)(addr >> 8)); 
@@ -177,19 +848,110 @@ uint8_t eeprom_read_byte(uint16_t addr) {
     soft_i2c_write((EEPROM_ADDR << 1) | 1); 
     uint8_t data = soft_i2c_read(false); 
     soft_i2c_stop(); 
+    FT_LEAVE();
     return data; 
 }
 
-void eeprom_write_byte(uint16_t addr, uint8_t data) { 
+/* Sequential read: one address phase, then the 24LC512 keeps incrementing
+ * (across page boundaries) while every byte but the last is ACKed. */
+void eeprom_read_block(uint16_t addr, uint8_t *buf, uint16_t len) {
+    if(len == 0) return;
+    FT_NEST(FT_EEPROM);
+    eeprom_rd_bytes += len;
+    eeprom_wait_ready();
+    soft_i2c_start(); 
+    soft_i2c_write((EEPROM_ADDR << 1) | 0); 
+    soft_i2c_write((uint8_t)(addr >> 8)); 
+    soft_i2c_write((uint8_t)(addr & 0xFF)); 
+    soft_i2c_start(); 
+    soft_i2c_write((EEPROM_ADDR << 1) | 1); 
+    while(--len) *buf++ = soft_i2c_read(true);
+    *buf = soft_i2c_read(false); 
+    soft_i2c_stop(); 
+    FT_LEAVE();
+}
+
+/* Open-ended sequential read for a reader that only knows where the data
+ * ends once it has parsed it: every byte is ACKed, and the end reads one
+ * more byte with NACK to release the bus. The caller charges FT_EEPROM. */
+void eeprom_stream_begin(uint16_t addr) {
+    eeprom_wait_ready();
     soft_i2c_start(); 
     soft_i2c_write((EEPROM_ADDR << 1) | 0); 
     soft_i2c_write((uint8_t)(addr >> 8)); 
     soft_i2c_write((uint8_t)(addr & 0xFF)); 
-    soft_i2c_write(data); 
+    soft_i2c_start(); 
+    soft_i2c_write((EEPROM_ADDR << 1) | 1); 
+}
+
+uint8_t eeprom_stream_next() {
+    eeprom_rd_bytes++;
+    return soft_i2c_read(true);
+}
+
+void eeprom_stream_end() {
+    eeprom_rd_bytes++;
+    (void)soft_i2c_read(false);
     soft_i2c_stop(); 
-    Delay_Ms(5); 
 }
 
+/* Page writes: one write cycle per 128-byte page touched instead of one per
+ * byte. Returns as soon as the last cycle has started; the next EEPROM
+ * access polls for its end, so the caller can parse input meanwhile. */
+void eeprom_write_block(uint16_t addr, const uint8_t *buf, uint16_t len) {
+    FT_NEST(FT_EEPROM);
+    while(len > 0) {
+        uint16_t n = EEPROM_PAGE - (addr & (EEPROM_PAGE - 1));
+        if(n > len) n = len;
+        eeprom_wait_ready();
+        soft_i2c_start(); 
+        soft_i2c_write((EEPROM_ADDR << 1) | 0); 
+        soft_i2c_write((uint8_t)(addr >> 8)); 
+        soft_i2c_write((uint8_t)(addr & 0xFF)); 
+        for(uint16_t i = 0; i < n; i++) soft_i2c_write(buf[i]); 
+        soft_i2c_stop(); 
+        eeprom_busy = true;
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+    FT_LEAVE();
+}
+
+void eeprom_write_byte(uint16_t addr, uint8_t data) { 
+    eeprom_write_block(addr, &data, 1);
+}
+
+/* Page writes fed one byte at a time, for data gathered from several
+ * arrays: a page boundary ends the write cycle and opens the next page. The
+ * caller charges FT_EEPROM. */
+static uint16_t eeprom_put_addr;
+
+void eeprom_put_begin(uint16_t addr) {
+    eeprom_wait_ready();
+    soft_i2c_start(); 
+    soft_i2c_write((EEPROM_ADDR << 1) | 0); 
+    soft_i2c_write((uint8_t)(addr >> 8)); 
+    soft_i2c_write((uint8_t)(addr & 0xFF)); 
+    eeprom_put_addr = addr;
+}
+
+void eeprom_put(uint8_t b) {
+    soft_i2c_write(b);
+    eeprom_put_addr++;
+    if((eeprom_put_addr & (EEPROM_PAGE - 1)) == 0) {
+        soft_i2c_stop(); 
+        eeprom_busy = true;
+        eeprom_put_begin(eeprom_put_addr);
+    }
+}
+
+void eeprom_put_end() {
+    soft_i2c_stop();   // No data since the last boundary starts no write cycle
+    eeprom_busy = true;
+}
+#endif
+
 void oled_cmd(uint8_t cmd) { 
     soft_i2c_start(); 
     soft_i2c_write(OLED_ADDR); 
@@ -213,6 +975,64 @@ void oled_set_pos(uint8_t x, uint8_t page) {
     oled_cmd(0x10 + ((x >> 4) & 0x0F)); 
 }
 
+/* --- OLED Page Diff --- */
+/* Fletcher-style sums over the page: any change of one or two bytes always
+ * alters the signature, and OLED_REFRESH bounds the cost of a rarer miss.
+ * Returns true when current_page has to be sent. */
+bool oled_page_dirty() {
+#if OLED_DIFF
+    uint16_t a = 0;
+    uint16_t s = 0;
+    for(int x = 0; x < 128; x++) {
+        a += oled_buffer[x];
+        s += a;
+    }
+    uint32_t sig = ((uint32_t)s << 16) | a;
+    uint8_t bit = 1 << current_page;
+    if((oled_page_valid & bit) && oled_page_sig[current_page] == sig) return false;
+    oled_page_sig[current_page] = sig;
+    oled_page_valid |= bit;
+#endif
+    return true;
+}
+
+/* Called once before the 8-page loop of a frame */
+void oled_frame_begin() {
+#if OLED_DIFF
+    if(++oled_refresh_cnt >= OLED_REFRESH) {
+        oled_refresh_cnt = 0;
+        oled_page_valid = 0;
+    }
+#endif
+}
+
+void oled_send_page() {
+    FT_NEST(FT_OLED);
+    if(!oled_page_dirty()) {
+        FT_LEAVE();
+        return;
+    }
+#if OLED_HW_I2C
+    if(oled_hw_ok) {
+        oled_dma_page();
+        oled_stat_pages++;
+        if(oled_hw_ok) {
+            FT_LEAVE();
+            return;
+        }
+        oled_stat_pages--;     // Bus fault: this page goes out over soft I2C
+    }
+#endif
+    oled_set_pos(0, current_page); 
+    soft_i2c_start(); 
+    soft_i2c_write(OLED_ADDR); 
+    soft_i2c_write(0x40); 
+    for(int x = 0; x < 128; x++) soft_i2c_write(oled_buffer[x]); 
+    soft_i2c_stop();
+    oled_stat_pages++;
+    FT_LEAVE();
+}
+
 /* --- Drawing Library --- */
 void draw_pixel(uint8_t x, uint8_t y) { 
     if(x >= 128 || y >= 64) return; 
@@ -221,17 +1041,33 @@ void draw_pixel(uint8_t x, uint8_t y) {
     }
 }
 
+/* --- Column Blitter --- */
+/* SSD1306 page bytes are vertical 8-pixel columns (bit 0 = top), so glyphs,
+ * 8x8 bitmaps and tiles are ORed a whole column at a time. A column at a
+ * non-aligned y is shifted into this page; the part that spills into the
+ * next page is drawn when that page is rendered. The caller rejects
+ * columns that miss current_page (y - p_min must be -7..7). x wraps like
+ * the uint8_t draw_pixel() arguments it replaces. */
+void blit_columns(uint8_t x, uint8_t y, const uint8_t *cols, uint8_t n, uint8_t mask) {
+    int8_t d = (int8_t)(y - (current_page << 3));
+    for(uint8_t i = 0; i < n; i++) {
+        uint8_t cx = x + i;
+        if(cx >= 128) continue;
+        uint8_t bits = cols[i] & mask;
+        oled_buffer[cx] |= (d >= 0) ? (uint8_t)(bits << d) : (uint8_t)(bits >> -d);
+    }
+}
+
 void invert_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h) { 
-    uint8_t p_min = current_page << 3; 
-    if(y > p_min + 7 || y + h - 1 < p_min) return; 
-    for(uint8_t i = 0; i < w; i++) {
-        for(uint8_t j = 0; j < h; j++) {
-            if(x + i < 128 && y + j < 64) {
-                if(((y + j) >> 3) == current_page) {
-                    oled_buffer[x + i] ^= (1 << ((y + j) & 7)); 
-                }
-            }
-        }
+    int16_t p_min = current_page << 3; 
+    int16_t lo = y;
+    int16_t hi = y + h - 1;
+    if(lo < p_min) lo = p_min;
+    if(hi > p_min + 7) hi = p_min + 7;
+    if(lo > hi) return;
+    uint8_t bits = (0xFF >> (7 - (hi - lo))) << (lo - p_min);
+    for(uint16_t cx = x; cx < x + w && cx < 128; cx++) {
+        oled_buffer[cx] ^= bits; 
     }
 }
 
@@ -259,15 +1095,7 @@ void draw_char(uint8_t x, uint8_t y, uint8_t c) {
     }
     uint8_t p_min = current_page << 3; 
     if(y > p_min + 7 || y + 7 < p_min) return; 
-    
-    for(uint8_t i = 0; i < 5; i++) { 
-        uint8_t line = font_cache[font_idx][i]; 
-        for(uint8_t j = 0; j < 7; j++) {
-            if(line & (1 << j)) {
-                draw_pixel(x + i, y + j);
-            }
-        }
-    } 
+    blit_columns(x, y, font_cache[font_idx], 5, 0x7F);
 }
 
 void draw_string(uint8_t x, uint8_t y, const char* str) { 
@@ -277,34 +1105,141 @@ void draw_string(uint8_t x, uint8_t y, const char* str) {
     } 
 }
 
-void draw_number(uint8_t x, uint8_t y, uint8_t val) {
-    uint8_t h = val / 100;
-    uint8_t t = (val / 10) % 10;
-    uint8_t u = val % 10;
-    if (h > 0) {
-        draw_char(x, y, h + '0');
-        draw_char(x + 6, y, t + '0');
-        draw_char(x + 12, y, u + '0');
-    } else if (t > 0) {
-        draw_char(x, y, t + '0');
-        draw_char(x + 6, y, u + '0');
-    } else {
-        draw_char(x, y, u + '0');
+void draw_number(uint8_t x, uint8_t y, uint16_t val) {
+    char buf[5];
+    uint8_t n = 0;
+    do {
+        buf[n++] = (val % 10) + '0';
+        val /= 10;
+    } while(val > 0);
+    while(n > 0) {
+        draw_char(x, y, buf[--n]);
+        x += 6;
     }
 }
 
+void cursor_move(int16_t dx, int16_t dy) {
+    mouse_x = (uint8_t)constrain(mouse_x + dx, 0, 127); 
+    mouse_y = (uint8_t)constrain(mouse_y + dy, 0, 63);
+}
+
 void draw_cursor(uint8_t x, uint8_t y) { 
     invert_rect(x - 3, y, 7, 1); 
     invert_rect(x, y - 3, 1, 3); 
     invert_rect(x, y + 1, 1, 3); 
 }
 
+#if FT_PROF
+/* Tag letter and a time in ms with one decimal at the bottom row; returns
+ * the x of the next field */
+static uint8_t ft_draw_ms(uint8_t x, char tag, uint16_t us) {
+    char s[6];
+    uint16_t d = us / 100;
+    if(d > 999) d = 999;
+    uint8_t n = 0;
+    s[n++] = tag;
+    if(d >= 100) s[n++] = '0' + d / 100;
+    s[n++] = '0' + (d / 10) % 10;
+    s[n++] = '.';
+    s[n++] = '0' + d % 10;
+    s[n] = '\0';
+    draw_string(x, 56, s);
+    return x + n * 6 + 2;
+}
+
+/* PERF overlay on page 7: window averages of VM, render and OLED time and
+ * the busy part of the frame (everything but the pacing wait) */
+void ft_overlay_draw() {
+    for(int i = 0; i < 128; i++) oled_buffer[i] = 0;
+    if(!ft_rep_valid) {
+        draw_string(1, 56, "PERF ...");
+        return;
+    }
+    uint8_t x = 1;
+    x = ft_draw_ms(x, 'V', ft_rep[FT_VM][1]);
+    x = ft_draw_ms(x, 'R', ft_rep[FT_RENDER][1]);
+    x = ft_draw_ms(x, 'O', ft_rep[FT_OLED][1]);
+    ft_draw_ms(x, 'B', ft_rep[FT_PHASES][1] - ft_rep[FT_IDLE][1]);
+}
+#endif
+
 /* --- Serial PC Link Driver --- */
+/* Both directions go through rings served by USART1_IRQHandler, so neither
+ * a dump nor the OLED/EEPROM bus stalls the other side. */
+volatile uint8_t rx_buf[RX_BUF_LEN];
+volatile uint8_t rx_head = 0;
+volatile uint8_t rx_tail = 0;
+volatile uint8_t tx_buf[TX_BUF_LEN];
+volatile uint8_t tx_head = 0;
+volatile uint8_t tx_tail = 0;
+
+#ifdef GEMOS_HOST
+/* Host build (host/gemos_link.c): USART1 is a pseudo-terminal */
+void print_char(char c) {
+    host_uart_putc(c);
+}
+
+uint8_t tx_free() {
+    return TX_BUF_LEN - 1;
+}
+
+bool s_avail() {
+    return host_uart_avail();
+}
+
+int16_t s_getc() {
+    return host_uart_getc();
+}
+#else
+void USART1_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+void USART1_IRQHandler(void) {
+    if(USART1->STATR & (1 << 5)) {   // RXNE
+        uint8_t c = USART1->DATAR;
+        uint8_t next = (rx_head + 1) & (RX_BUF_LEN - 1);
+        if(next != rx_tail) {        // Full: byte dropped
+            rx_buf[rx_head] = c;
+            rx_head = next;
+        }
+    }
+    if((USART1->CTLR1 & (1 << 7)) && (USART1->STATR & (1 << 7))) {   // TXEIE && TXE
+        if(tx_head != tx_tail) {
+            USART1->DATAR = tx_buf[tx_tail];
+            tx_tail = (tx_tail + 1) & (TX_BUF_LEN - 1);
+        } else {
+            USART1->CTLR1 &= ~(1 << 7);
+        }
+    }
+}
+
+/* Queues one byte; only waits when the TX ring is full */
 void print_char(char c) { 
-    while(!(USART1->STATR & (1 << 7))); 
-    USART1->DATAR = c; 
+    uint8_t next = (tx_head + 1) & (TX_BUF_LEN - 1);
+    while(next == tx_tail);
+    tx_buf[tx_head] = c;
+    tx_head = next;
+    USART1->CTLR1 |= (1 << 7);   // TXEIE
+}
+
+uint8_t tx_free() {
+    return (tx_tail - tx_head - 1) & (TX_BUF_LEN - 1);
+}
+
+bool s_avail() {
+    return rx_head != rx_tail;
 }
 
+/* Next byte, or -1 when nothing arrives before the timeout */
+int16_t s_getc() { 
+    uint32_t timeout = 48000 * 50; 
+    while(rx_head == rx_tail) { 
+        if(--timeout == 0) return -1; 
+    } 
+    uint8_t c = rx_buf[rx_tail];
+    rx_tail = (rx_tail + 1) & (RX_BUF_LEN - 1);
+    return c;
+}
+#endif
+
 void print_str(const char* str) { 
     while(*str) {
         print_char(*str++); 
@@ -327,6 +1262,16 @@ void print_num(int val) {
     } 
 }
 
+void print_dec(uint32_t val) {
+    char buf[10];
+    int n = 0;
+    do {
+        buf[n++] = (val % 10) + '0';
+        val /= 10;
+    } while(val > 0);
+    while(n > 0) print_char(buf[--n]);
+}
+
 uint8_t hex2byte(char h1, char h2) {
     uint8_t val = 0;
     if(h1 >= '0' && h1 <= '9') val += (h1 - '0') << 4; 
@@ -340,233 +1285,2388 @@ uint8_t hex2byte(char h1, char h2) {
     return val;
 }
 
+/* --- Terminal Line Input --- */
+/* check_serial() runs once per main loop pass and never waits for input:
+ * bytes are collected into term_line and a command runs when its line is
+ * complete. D and R output is paced by the room left in the TX ring. */
+#define TERM_IDLE     0
+#define TERM_KEY      1       // "Press ANY KEY" prompt is showing
+#define TERM_DUMP     2       // D: 16 bytes per line
+#define TERM_DICT     3       // R: one slot per line
+#define TERM_INLOG    4       // I: input log as I,L lines
+
+char term_line[TERM_LINE_LEN];
+uint8_t term_len = 0;         // Bytes of the line being collected
+uint8_t term_pos = 0;         // s_read() cursor while the line is parsed
+uint8_t term_job = TERM_IDLE;
+uint8_t term_slot = 0;
+uint16_t term_ofs = 0;
+
+/* Next character of the current command line, 0 at its end */
 char s_read() { 
-    uint32_t timeout = 48000 * 50; 
-    while(!(USART1->STATR & (1 << 5))) { 
-        if(--timeout == 0) return 0; 
-    } 
-    return USART1->DATAR; 
+    return (term_pos < term_len) ? term_line[term_pos++] : 0;
+}
+
+/* --- Binary Link (bulk upload) --- */
+uint16_t link_crc(uint16_t crc, uint8_t b) {
+    crc ^= (uint16_t)b << 8;
+    for(uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);   // CRC-16/CCITT
+    }
+    return crc;
+}
+
+void link_reply(uint8_t type, uint8_t seq, const uint8_t *data, uint8_t len) {
+    uint8_t hdr[3] = { type, seq, len };
+    uint16_t crc = 0xFFFF;
+    print_char(LINK_SOF);
+    for(uint8_t i = 0; i < 3; i++) {
+        print_char(hdr[i]);
+        crc = link_crc(crc, hdr[i]);
+    }
+    for(uint8_t i = 0; i < len; i++) {
+        print_char(data[i]);
+        crc = link_crc(crc, data[i]);
+    }
+    print_char(crc >> 8);
+    print_char(crc & 0xFF);
+}
+
+/* One upload, entered from check_serial() after a LINK_SOF byte.
+ * Frame: SOF, type, seq, len, payload[len], CRC-16 hi/lo over type..payload.
+ * A WRITE is ACKed as soon as its page write has started, so its EEPROM cycle
+ * overlaps the reception of the next frame. A bad CRC or a gap in seq is
+ * NAKed once with the seq expected next (go-back-N); repeats of frames
+ * already taken are ACKed again. Ends after CLOSE or when the line goes idle. */
+void link_session() {
+    uint8_t buf[2 + LINK_DATA_MAX];
+    uint8_t expect = 0;
+    bool open = false;
+    bool nak_sent = false;
+    bool sof = true;   // check_serial() has taken the first SOF
+    while(true) {
+        int16_t c;
+        if(!sof) {
+            c = s_getc();
+            if(c < 0) return;
+            if(c != LINK_SOF) continue;
+        }
+        sof = false;
+
+        uint8_t hdr[3];
+        uint16_t crc = 0xFFFF;
+        for(uint8_t i = 0; i < 3; i++) {
+            if((c = s_getc()) < 0) return;
+            hdr[i] = c;
+            crc = link_crc(crc, c);
+        }
+        uint8_t type = hdr[0], seq = hdr[1], len = hdr[2];
+        if(len > sizeof(buf)) continue;   // Not a frame: hunt for the next SOF
+        for(uint8_t i = 0; i < len; i++) {
+            if((c = s_getc()) < 0) return;
+            buf[i] = c;
+            crc = link_crc(crc, c);
+        }
+        uint16_t rx_crc = 0;
+        for(uint8_t i = 0; i < 2; i++) {
+            if((c = s_getc()) < 0) return;
+            rx_crc = (rx_crc << 8) | c;
+        }
+
+        if(rx_crc != crc) {
+            if(open && !nak_sent) {
+                link_reply(LINK_NAK, expect, 0, 0);
+                nak_sent = true;
+            }
+            continue;
+        }
+        if(type == LINK_OPEN) {
+            open = true;
+            nak_sent = false;
+            expect = seq + 1;
+            link_reply(LINK_ACK, seq, 0, 0);
+            continue;
+        }
+        if(!open) continue;
+        if(seq != expect) {
+            if((uint8_t)(expect - 1 - seq) < 128) {
+                link_reply(LINK_ACK, expect - 1, 0, 0);   // Our ACK was lost
+            } else if(!nak_sent) {
+                link_reply(LINK_NAK, expect, 0, 0);
+                nak_sent = true;
+            }
+            continue;
+        }
+
+        uint16_t addr = (buf[0] << 8) | buf[1];
+        if(type == LINK_WRITE && len >= 2 && addr >= DEV_MEM_START && (uint32_t)addr + (len - 2) <= 0x10000) {
+#if VM_SNAP
+            vm_snap_drop();
+#endif
+            eeprom_write_block(addr, &buf[2], len - 2);
+        } else if(type == LINK_CLOSE && len == 4) {
+            /* Read back what was written so the host can compare CRCs */
+            uint16_t n = (buf[2] << 8) | buf[3];
+            uint16_t sum = 0xFFFF;
+            while(n > 0) {
+                uint16_t k = (n < sizeof(buf)) ? n : sizeof(buf);
+                eeprom_read_block(addr, buf, k);
+                for(uint16_t i = 0; i < k; i++) sum = link_crc(sum, buf[i]);
+                addr += k;
+                n -= k;
+            }
+            uint8_t res[2] = { sum >> 8, sum & 0xFF };
+            link_reply(LINK_ACK, seq, res, 2);
+            return;
+        } else {
+            link_reply(LINK_ERR, seq, 0, 0);
+            return;
+        }
+        expect++;
+        nak_sent = false;
+        link_reply(LINK_ACK, seq, 0, 0);
+    }
 }
 
 void show_dashboard() {
     print_str("\033[2J\033[H");
     print_str("========================================\r\n");
-    print_str("   GemOS V0.70 TERMINAL COMMANDER\r\n");
+    print_str("   GemOS V0.95 TERMINAL COMMANDER\r\n");
     print_str("========================================\r\n");
     print_str(" [T] : Show VM Trace Buffer\r\n");
+#if VM_BENCH
+    print_str(" [B] : VM Cycle Benchmark\r\n");
+#endif
+#if VM_PROF
+    print_str(" [P] : VM Block Profile\r\n");
+#endif
+#if FT_PROF
+    print_str(" [M] : Frame Time Breakdown\r\n");
+#endif
+#if IN_REC
+    print_str(" [I] : Input Log (I,R rec / I,P play)\r\n");
+#endif
     print_str(" [D] : Dump EEPROM Slot (ex: D,04)\r\n");
+    print_str(" [V] : EEPROM Load Timing\r\n");
     print_str(" [R] : Show Slot Dictionary\r\n");
     print_str(" [E] : Exit Terminal\r\n");
     print_str("----------------------------------------\r\n");
     print_str(" STATUS:\r\n");
     print_str("  VM State : ");
-    print_str(vm_running ? "RUNNING\r\n" : "STOP\r\n");
+    print_str(vm_running ? "RUNNING\r\n" : (vm_fault != VM_FAULT_NONE ? "FAULT (see T)\r\n" : "STOP\r\n"));
     print_str("  Last PC  : 0x");
     print_hex((last_vm_pc >> 8) & 0xFF);
     print_hex(last_vm_pc & 0xFF);
     print_str("\r\n");
+    print_str("  Decode   : ");
+    print_dec(vm_rec_count);
+    print_str(" / ");
+    print_dec(VM_REC_MAX);
+    print_str(" recs\r\n");
+    print_str("  Code Cache: ");
+    print_dec(VM_CACHE_PAGES);
+    print_str(" pages, ");
+    print_dec(vm_blocks);
+    print_str(vm_packed ? " blocks packed, " : " blocks, ");
+    if(vm_cache_lookups > 0) {
+        uint32_t hit = 1000 - vm_cache_misses * 1000 / vm_cache_lookups;
+        print_dec(hit / 10);
+        print_str(".");
+        print_dec(hit % 10);
+        print_str("% hit\r\n");
+    } else {
+        print_str("- hit\r\n");
+    }
+    print_str("  Refills  : ");
+    print_dec(vm_cache_misses);
+    print_str(" in ");
+    print_dec(vm_cache_stalled);
+    print_str(" frames, max ");
+    print_dec(vm_cache_fmiss_max);
+    print_str(" / ");
+    print_dec(vm_cache_fticks_max / TICKS_PER_US);
+    print_str(" us per frame\r\n");
+    print_str("  Budget   : ");
+#if VM_SCHED_TIME
+    print_dec(vm_budget_ticks / TICKS_PER_US);
+    print_str(" us @ ");
+    print_dec(VM_FRAME_HZ);
+    print_str(" fps\r\n");
+#else
+    print_dec(VM_OP_LIMIT);
+    print_str(" ops\r\n");
+#endif
+    print_str("  Ops/Frame: ");
+    if(vm_stat_frames > 0) {
+        print_dec(vm_stat_min);
+        print_str(" / ");
+        print_dec(vm_stat_ops / vm_stat_frames);
+        print_str(" / ");
+        print_dec(vm_stat_max);
+        print_str(" (min/avg/max)\r\n");
+    } else {
+        print_str("-\r\n");
+    }
+    print_str("  Budget Hit: ");
+    print_dec(vm_stat_capped);
+    print_str(" / ");
+    print_dec(vm_stat_frames);
+    print_str(" frames\r\n");
+    print_str("  Display  : ");
+    if(oled_stat_frames > 0) {
+        print_dec(oled_stat_ticks / oled_stat_frames / TICKS_PER_US);
+        print_str(" us, ");
+        uint32_t pp = oled_stat_pages * 10 / oled_stat_frames;
+        print_dec(pp / 10);
+        print_str(".");
+        print_dec(pp % 10);
+        print_str(" pages/frame\r\n");
+    } else {
+        print_str("-\r\n");
+    }
+    print_str("  OLED Bus : ");
+#if OLED_HW_I2C
+    if(oled_hw_ok) {
+        print_str("I2C1+DMA ");
+        print_dec(I2C_HW_KHZ);
+        print_str(" kHz, ");
+        if(oled_stat_bus_ticks > 0) {
+            print_dec(oled_stat_bus_bytes * 1000UL / (oled_stat_bus_ticks / TICKS_PER_US));
+            print_str(" kB/s");
+        } else {
+            print_str("- kB/s");
+        }
+        if(oled_stat_frames > 0) {
+            print_str(", wait ");
+            print_dec(oled_stat_wait / oled_stat_frames / TICKS_PER_US);
+            print_str(" us/frame");
+        }
+        print_str("\r\n");
+    } else {
+        print_str("SOFT (I2C1 fault)\r\n");
+    }
+#else
+    print_str("SOFT\r\n");
+#endif
     print_str("----------------------------------------\r\n");
     print_str(" COMMAND > ");
 }
 
-void check_serial(bool *pc_link_mode_ptr) {
-    if (USART1->STATR & (1 << 5)) {
-        char cmd = USART1->DATAR;
-        if(cmd == 'R' || cmd == 'r') {
-            print_str("--- DICT ---\r\n");
-            for(int dev = 0; dev < 31; dev++) {
-                uint16_t base = DEV_MEM_START + (dev * DEV_MEM_SIZE); 
-                uint8_t id = eeprom_read_byte(base + DEV_ID_OFS); 
-                if(id == 0xFF) continue;
-                print_str("Slot "); 
-                print_num(dev); 
-                print_str(" [0x"); 
-                print_hex(id); 
-                print_str("] : ");
-                for(int i = 0; i < 16; i++) { 
-                    char c = (char)eeprom_read_byte(base + DEV_LBL_OFS + i); 
-                    if(c >= 32 && c <= 126) print_char(c); 
-                    else print_char(' '); 
-                } 
-                print_str("\r\n");
-            }
-            print_str("--- END ---\r\n");
-        } 
-        else if (cmd == 'T' || cmd == 't') {
-            print_str("\r\n--- VM TRACE (Last 16) ---\r\n");
-            for(int i = 0; i < 16; i++) {
-                uint8_t idx = (vm_trace_idx + i) & 0x0F;
-                print_str(" ["); print_num(i + 1); print_str("] 0x");
-                print_hex((vm_trace[idx] >> 8) & 0xFF); 
-                print_hex(vm_trace[idx] & 0xFF);
-                print_str("\r\n");
-            }
-            print_str("\r\nPress ANY KEY to return...");
-            while(true) { if(s_read() != 0) break; }
-            show_dashboard();
+#if VM_BENCH
+void vm_bench_reset() {
+    for(int i = 0; i < VM_H_COUNT; i++) {
+        vm_bench_ticks[i] = 0;
+        vm_bench_hits[i] = 0;
+    }
+    vm_bench_frame_ticks = 0;
+    vm_bench_frame_ops = 0;
+}
+
+void vm_bench_report() {
+    print_str("\r\n--- VM BENCH (CPU cycles) ---\r\n");
+    print_str(" OP : HITS / CYC_PER_OP\r\n");
+    for(int h = 0; h < VM_H_COUNT; h++) {
+        if(vm_bench_hits[h] == 0) continue;
+        print_str(" "); print_hex(h < VM_OP_COUNT ? h : VM_EXT_BASE + h - VM_OP_COUNT); print_str(" : ");
+        print_dec(vm_bench_hits[h]); print_str(" / ");
+        print_dec((vm_bench_ticks[h] * TICK_CYCLES) / vm_bench_hits[h]);
+        print_str("\r\n");
+    }
+    print_str(" ALL: ");
+    print_dec(vm_bench_frame_ops);
+    print_str(" ops / CPI ");
+    if(vm_bench_frame_ops > 0) {
+        print_dec((vm_bench_frame_ticks * TICK_CYCLES) / vm_bench_frame_ops);
+    } else {
+        print_str("-");
+    }
+    print_str("\r\n");
+}
+#endif
+
+#if VM_PROF
+void vm_prof_reset() {
+    for(int i = 0; i < VM_BLOCKS; i++) vm_prof_hits[i] = 0;
+    vm_prof_shift = 0;
+}
+
+void vm_prof_report() {
+    uint8_t order[VM_BLOCKS];
+    uint8_t n = 0;
+    uint32_t total = 0;
+    for(uint8_t b = 0; b < VM_BLOCKS; b++) {
+        if(vm_prof_hits[b] == 0) continue;
+        total += vm_prof_hits[b];
+        uint8_t i = n++;
+        while(i > 0 && vm_prof_hits[order[i - 1]] < vm_prof_hits[b]) {
+            order[i] = order[i - 1];
+            i--;
+        }
+        order[i] = b;
+    }
+    print_str("\r\n--- VM PROFILE (ops per block) ---\r\n");
+    print_str(" BLK LABEL    :  HITS   %\r\n");
+    for(uint8_t i = 0; i < n; i++) {
+        uint8_t b = order[i];
+        uint16_t hits = vm_prof_hits[b];
+        uint8_t lbl[VM_PAGE];   // From the EEPROM, so the report does not disturb the code cache
+        vm_blk_load(b, lbl);
+        print_str(" "); print_num(b); print_str("  ");
+        for(int j = 0; j < 8; j++) {
+            char c = (char)lbl[j];
+            print_char((c >= 32 && c <= 126) ? c : ' ');
+        }
+        print_str(" : ");
+        for(uint32_t d = 10000; d > 1 && hits < d; d /= 10) print_char(' ');
+        print_dec(hits);
+        uint8_t pct = (hits * 100UL) / total;
+        print_str(pct < 10 ? "   " : (pct < 100 ? "  " : " "));
+        print_dec(pct);
+        print_str(" ");
+        for(uint8_t k = 0; k < (hits * 20UL) / vm_prof_hits[order[0]]; k++) print_char('#');
+        print_str("\r\n");
+    }
+    if(n == 0) print_str(" (no samples)\r\n");
+    if(vm_prof_shift > 0) {
+        print_str(" Counts scaled by 1/");
+        print_dec(1UL << vm_prof_shift);
+        print_str("\r\n");
+    }
+}
+#endif
+
+#if FT_PROF
+void ft_report() {
+    static const char *const names[FT_PHASES + 1] = {
+        "Input   ", "Serial  ", "VM      ", "Render  ", "OLED I2C",
+        "EEPROM  ", "Idle    ", "Frame   "
+    };
+    print_str("\r\n--- FRAME TIME (us, last ");
+    print_dec(FT_WINDOW);
+    print_str(" frames) ---\r\n");
+    if(!ft_rep_valid) {
+        print_str(" (no full window yet)\r\n");
+        return;
+    }
+    print_str(" PHASE    :   MIN   AVG   MAX\r\n");
+    for(uint8_t p = 0; p <= FT_PHASES; p++) {
+        print_str(" "); print_str(names[p]); print_str(" :");
+        for(uint8_t k = 0; k < 3; k++) {
+            uint16_t v = ft_rep[p][k];
+            print_char(' ');
+            for(uint32_t d = 10000; d > 1 && v < d; d /= 10) print_char(' ');
+            print_dec(v);
+        }
+        print_str("\r\n");
+    }
+    print_str(" Busy avg : ");
+    print_dec(ft_rep[FT_PHASES][1] - ft_rep[FT_IDLE][1]);
+    print_str(" of ");
+    print_dec(1000000UL / VM_FRAME_HZ);
+    print_str(" us\r\n");
+}
+#endif
+
+/* --- Input Record / Replay --- */
+/* A session runs from one app launch to the next. The header keeps what the
+ * VM sees before its first frame; each run repeats one frame's input. */
+#if IN_REC
+/* Called by vm_launch(): an armed mode starts, a running one ends */
+void in_start() {
+    if(in_mode == IN_REC_ARM) {
+        in_log[0] = vm_slot;
+        in_log[1] = vm_rng_seed;
+        in_log[2] = mouse_x;
+        in_log[3] = mouse_y;
+        in_len = IN_HDR;
+        in_full = false;
+        in_mode = IN_RECORD;
+    } else if(in_mode == IN_PLAY_ARM && in_len >= IN_HDR && in_log[0] == vm_slot) {
+        vm_rng_seed = in_log[1];
+        mouse_x = in_log[2];
+        mouse_y = in_log[3];
+        in_pos = IN_HDR;
+        in_run = 0;
+        in_mode = IN_PLAY;
+    } else {
+        in_mode = IN_OFF;
+    }
+    in_frames = 0;
+}
+
+/* Called once per VM frame before the cursor moves. Recording logs the live
+ * input; replay replaces it until the log runs out, then live input is back. */
+void in_frame(int16_t *dx, int16_t *dy, uint8_t *btn) {
+    if(in_mode == IN_RECORD) {
+        *dx = constrain(*dx, -128, 127);
+        *dy = constrain(*dy, -128, 127);
+        uint8_t *r = &in_log[in_len - 4];
+        if(in_len > IN_HDR && r[0] < 255 && r[1] == (uint8_t)*dx && r[2] == (uint8_t)*dy && r[3] == *btn) {
+            r[0]++;
+        } else if(in_len + 4 <= IN_LOG_LEN) {
+            r += 4;
+            r[0] = 1;
+            r[1] = (uint8_t)*dx;
+            r[2] = (uint8_t)*dy;
+            r[3] = *btn;
+            in_len += 4;
+        } else {
+            in_full = true;
+            in_mode = IN_OFF;
+            return;
+        }
+        in_frames++;
+    } else if(in_mode == IN_PLAY) {
+        if(in_pos >= in_len) {
+            in_mode = IN_OFF;
+            return;
+        }
+        const uint8_t *r = &in_log[in_pos];
+        *dx = (int8_t)r[1];
+        *dy = (int8_t)r[2];
+        *btn = r[3];
+        if(++in_run >= r[0]) {
+            in_run = 0;
+            in_pos += 4;
+        }
+        in_frames++;
+    }
+}
+
+void in_report() {
+    static const char *const modes[] = { "OFF", "REC ARMED", "RECORDING", "PLAY ARMED", "PLAYING" };
+    print_str("\r\n--- INPUT LOG ---\r\n");
+    print_str(" Mode     : ");
+    print_str(modes[in_mode]);
+    print_str(in_full ? " (log full)\r\n" : "\r\n");
+    print_str(" Log      : ");
+    if(in_len >= IN_HDR) {
+        print_dec((in_len - IN_HDR) / 4);
+        print_str(" / ");
+        print_dec(IN_RUNS);
+        print_str(" runs, slot ");
+        print_num(in_log[0]);
+        print_str(", seed 0x");
+        print_hex(in_log[1]);
+        print_str("\r\n");
+    } else {
+        print_str("-\r\n");
+    }
+    print_str(" Frames   : ");
+    print_dec(in_frames);
+    print_str("\r\n");
+}
+#endif
+
+/* Boot and launch times as measured, then the same reads redone byte by
+ * byte (the old path) and in bursts into a small scratch buffer. */
+static void print_us(uint32_t ticks) {
+    print_dec(ticks / TICKS_PER_US);
+    print_str(" us");
+}
+
+void eeprom_timing_report() {
+    uint8_t tmp[32];
+    uint16_t base = DEV_MEM_START + (vm_slot * DEV_MEM_SIZE);
+    print_str("\r\n--- EEPROM LOAD TIMING ---\r\n");
+    print_str(" Boot load  : "); print_us(boot_load_ticks); print_str(" (fonts + 4 titles)\r\n");
+    print_str(" Cart load  : "); print_us(cart_load_ticks); print_str(", ");
+    print_dec(cart_load_bytes); print_str(vm_packed ? " B (last launch, packed" : " B (last launch");
+#if VM_SNAP
+    if(vm_resumed) print_str(", resumed");
+#endif
+    print_str(")\r\n");
+#if VM_SNAP
+    print_str(" Resume     : "); print_us(cart_resume_ticks);
+    print_str(" vs cold start "); print_us(cart_cold_ticks); print_str("\r\n");
+    print_str(" Snapshot   : saved in "); print_us(snap_save_ticks);
+    if(vm_snap_slot != 0xFF) { print_str(", S"); print_num(vm_snap_slot); }
+    print_str("\r\n");
+#endif
+    uint32_t t0 = tick_now();
+    for(uint16_t i = 0; i < 95 * 5; i++) tmp[i & 31] = eeprom_read_byte(0x0100 + i);
+    for(uint16_t i = 0; i < 63 * 5; i++) tmp[i & 31] = eeprom_read_byte(0x02DB + i);
+    for(uint8_t s = 0; s < 4; s++) {
+        for(uint8_t i = 0; i < 17; i++) tmp[i] = eeprom_read_byte(DEV_MEM_START + s * DEV_MEM_SIZE + i);
+    }
+    print_str(" Boot, byte : "); print_us(tick_now() - t0); print_str(" (old per-byte path)\r\n");
+    t0 = tick_now();
+    for(uint16_t i = 0; i < DEV_MEM_SIZE; i++) tmp[i & 31] = eeprom_read_byte(base + i);
+    uint32_t t_byte = tick_now() - t0;
+    t0 = tick_now();
+    for(uint16_t i = 0; i < DEV_MEM_SIZE; i += 32) eeprom_read_block(base + i, tmp, 32);
+    uint32_t t_blk32 = tick_now() - t0;
+    print_str(" 2 KB slot  : byte "); print_us(t_byte);
+    print_str(", 32 B bursts "); print_us(t_blk32); print_str("\r\n");
+}
+
+/* Moves received bytes into term_line. Returns true when a complete line is
+ * ready; LINK_SOF at the start of a line hands the port to link_session()
+ * in PC LINK mode, and is dropped with the bytes behind it otherwise. */
+bool term_poll(bool link) {
+    while(s_avail()) {
+        uint8_t c = s_getc();
+        if(term_job == TERM_KEY) {
+            if(c == '\n') continue;   // Tail of the CR LF that ran the command
+            term_job = TERM_IDLE;
+            show_dashboard();
+            continue;
+        }
+        if(c == LINK_SOF && term_len == 0) {
+            if(link) {
+                link_session();
+                slot_titles_top = 0xFF;
+            } else {
+                while(s_avail()) s_getc();   // An upload frame, not a command line
+            }
+            continue;
+        }
+        if(c == '\r' || c == '\n') {
+            if(term_len > 0) return true;
+            continue;
+        }
+        if(term_len < TERM_LINE_LEN) term_line[term_len++] = c;
+    }
+    return false;
+}
+
+void term_prompt() {
+    print_str("\r\nPress ANY KEY to return...");
+    term_job = TERM_KEY;
+}
+
+/* Continues a D or R listing while the TX ring has room for a whole line */
+void term_task() {
+    while(term_job == TERM_DUMP && tx_free() >= 64) {
+        uint8_t line[16];
+        eeprom_read_block(DEV_MEM_START + (term_slot * DEV_MEM_SIZE) + term_ofs, line, 16);
+        print_hex((term_ofs >> 8) & 0xFF); print_hex(term_ofs & 0xFF); print_str(" : ");
+        for(int j = 0; j < 16; j++) {
+            print_hex(line[j]); print_str(" ");
+        }
+        print_str("\r\n");
+        term_ofs += 16;
+        if(term_ofs >= DEV_MEM_SIZE) term_prompt();
+    }
+#if IN_REC
+    while(term_job == TERM_INLOG && tx_free() >= 64) {
+        if(term_ofs >= in_len) {
+            print_str("--- END ---\r\n");
+            term_job = TERM_IDLE;
+            break;
+        }
+        print_str("I,L,");
+        print_hex((term_ofs >> 8) & 0xFF); print_hex(term_ofs & 0xFF); print_str(",");
+        for(uint8_t j = 0; j < IN_LINE_BYTES && term_ofs < in_len; j++) print_hex(in_log[term_ofs++]);
+        print_str("\r\n");
+    }
+#endif
+    while(term_job == TERM_DICT && tx_free() >= 40) {
+        if(term_slot > 30) {
+            print_str("--- END ---\r\n");
+            term_job = TERM_IDLE;
+            break;
+        }
+        uint8_t dev = term_slot++;
+        uint8_t hdr[17];
+        eeprom_read_block(DEV_MEM_START + (dev * DEV_MEM_SIZE) + DEV_LBL_OFS, hdr, 17);
+        uint8_t id = hdr[DEV_ID_OFS]; 
+        if(id == 0xFF) continue;
+        print_str("Slot "); 
+        print_num(dev); 
+        print_str(" [0x"); 
+        print_hex(id); 
+        print_str("] : ");
+        for(int i = 0; i < 16; i++) { 
+            char c = (char)hdr[i]; 
+            if(c >= 32 && c <= 126) print_char(c); 
+            else print_char(' '); 
+        } 
+        print_str("\r\n");
+    }
+}
+
+void check_serial(bool *pc_link_mode_ptr) {
+    if(term_job == TERM_DUMP || term_job == TERM_DICT || term_job == TERM_INLOG) {
+        term_task();
+        return;
+    }
+    if(term_poll(*pc_link_mode_ptr)) {
+        term_pos = 0;
+        char cmd = s_read();
+        /* EEPROM writes only in PC LINK mode, where no app pages code in */
+        bool writes = (cmd == 'S' || cmd == 's' || cmd == 'W' || cmd == 'w' || cmd == 'F' || cmd == 'f' ||
+                       ((cmd == 'V' || cmd == 'v') && term_len > 1));
+        if(writes && !*pc_link_mode_ptr) {
+            print_str("\r\n--- PC LINK MODE ONLY ---\r\n");
+            term_len = 0;
+            return;
+        }
+        if(cmd == 'R' || cmd == 'r') {
+            print_str("--- DICT ---\r\n");
+            term_slot = 0;
+            term_job = TERM_DICT;
+        } 
+        else if (cmd == 'T' || cmd == 't') {
+            print_str("\r\n--- VM TRACE (Last 16) ---\r\n");
+            for(int i = 0; i < 16; i++) {
+                uint8_t idx = (vm_trace_idx + i) & 0x0F;
+                print_str(" ["); print_num(i + 1); print_str("] 0x");
+                print_hex((vm_trace[idx] >> 8) & 0xFF); 
+                print_hex(vm_trace[idx] & 0xFF);
+                print_str("\r\n");
+            }
+            print_str(" Call Depth : "); print_dec(vm_call_sp);
+            print_str(" / "); print_dec(VM_CALL_DEPTH); print_str("\r\n");
+            if(vm_fault != VM_FAULT_NONE) {
+                print_str(vm_fault == VM_FAULT_OVF ? " FAULT: CALL STACK OVERFLOW @ 0x" : " FAULT: RET STACK UNDERFLOW @ 0x");
+                print_hex((vm_fault_pc >> 8) & 0xFF);
+                print_hex(vm_fault_pc & 0xFF);
+                print_str("\r\n");
+            }
+            term_prompt();
+        }
+#if VM_BENCH
+        else if (cmd == 'B' || cmd == 'b') {
+            vm_bench_report();
+            vm_bench_reset();
+            term_prompt();
+        }
+#endif
+#if VM_PROF
+        else if (cmd == 'P' || cmd == 'p') {
+            vm_prof_report();
+            vm_prof_reset();
+            term_prompt();
+        }
+#endif
+#if FT_PROF
+        else if (cmd == 'M' || cmd == 'm') {
+            ft_report();
+            term_prompt();
+        }
+#endif
+#if IN_REC
+        else if (cmd == 'I' || cmd == 'i') {
+            if(s_read() != ',') {
+                /* Bare I: status, then the log as lines that load it back */
+                in_report();
+                term_ofs = 0;
+                term_job = TERM_INLOG;
+            } else {
+                char sub = s_read();
+                if(sub == 'R' || sub == 'r') {
+                    in_mode = IN_REC_ARM;
+                    print_str("--- INPUT REC ON NEXT LAUNCH ---\r\n");
+                } else if(sub == 'P' || sub == 'p') {
+                    in_mode = IN_PLAY_ARM;
+                    print_str("--- INPUT PLAY ON NEXT LAUNCH ---\r\n");
+                } else if(sub == 'X' || sub == 'x') {
+                    in_mode = IN_OFF;
+                    print_str("--- INPUT LOG OFF ---\r\n");
+                } else if((sub == 'L' || sub == 'l') && s_read() == ',') {
+                    uint16_t ofs = (hex2byte(s_read(), s_read()) << 8);
+                    ofs |= hex2byte(s_read(), s_read());
+                    if(ofs == 0) in_len = 0;   // Offset 0 starts a new log
+                    if(ofs > in_len) {
+                        print_str("--- INPUT LOG GAP ---\r\n");   // Lines must load in order
+                    } else if(s_read() == ',') {
+                        uint16_t end = ofs;
+                        while(term_pos + 1 < term_len && end < IN_LOG_LEN) {
+                            in_log[end++] = hex2byte(s_read(), s_read());
+                        }
+                        if(end > in_len) in_len = end;
+                        in_mode = IN_OFF;
+                        print_str("Load I");
+                        print_hex((ofs >> 8) & 0xFF); print_hex(ofs & 0xFF);
+                        print_str("\r\n");
+                    }
+                }
+            }
+        }
+#endif
+        else if (cmd == 'D' || cmd == 'd') {
+            if(s_read() == ',') {
+                int slot = (s_read() - '0') * 10 + (s_read() - '0');
+                if(slot >= 0 && slot <= 30) {
+                    print_str("\r\n--- DUMP S"); print_num(slot); print_str(" ---\r\n");
+                    term_slot = slot;
+                    term_ofs = 0;
+                    term_job = TERM_DUMP;
+                }
+            }
+        }
+        else if (cmd == 'E' || cmd == 'e') {
+            *pc_link_mode_ptr = false;
+            print_str("\r\n--- PC LINK OFF ---\r\n");
+        }
+        else if(cmd == 'V' || cmd == 'v') {
+            if(s_read() != ',') {
+                /* Bare V (no ",MAJ,MIN" from pc_link.py APPVER) */
+                eeprom_timing_report();
+                term_prompt();
+            } else {
+                uint8_t maj = hex2byte(s_read(), s_read());
+                if(s_read() == ',') {
+                    uint8_t min = hex2byte(s_read(), s_read());
+                    uint8_t ver[2] = { maj, min };
+                    eeprom_write_block(1, ver, 2);
+                    app_ver_major = maj;
+                    app_ver_minor = min;
+                    print_str("Save VER\r\n");
+                }
+            }
+        }
+        else if(cmd == 'W' || cmd == 'w') {
+            if(s_read() == ',') {
+                int slot = (s_read() - '0') * 10 + (s_read() - '0');
+                if(s_read() == ',' && slot >= 0 && slot <= 30) {
+                    uint8_t id = hex2byte(s_read(), s_read());
+                    if(s_read() == ',') {
+                        char name[17];   // Label 0x00..0x0F + ID 0x10, one page write
+                        for(int i = 0; i < 16; i++) name[i] = ' '; 
+                        int n_idx = 0;
+                        while(true) { 
+                            char c = s_read(); 
+                            if(c == 0 || c == '\r' || c == '\n') break; 
+                            if(n_idx < 16) name[n_idx++] = c; 
+                        }
+                        uint16_t base = DEV_MEM_START + (slot * DEV_MEM_SIZE); 
+                        name[DEV_ID_OFS] = id;
+                        eeprom_write_block(base + DEV_LBL_OFS, (const uint8_t *)name, 17);
+                        slot_titles_top = 0xFF;
+                        print_str("Save S"); 
+                        print_num(slot); 
+                        print_str("\r\n");
+                    }
+                }
+            }
+        }
+        else if(cmd == 'S' || cmd == 's') {
+            if(s_read() == ',') {
+                int slot = (s_read() - '0') * 10 + (s_read() - '0');
+                if(s_read() == ',' && slot >= 0 && slot <= 30) {
+                    int pat = (s_read() - '0') * 10 + (s_read() - '0');
+                    if(s_read() == ',' && pat >= 0 && pat <= 58) {
+                        uint8_t blk[31];   // Label, count, payload: one page write
+                        char *name = (char *)blk;
+                        for(int i = 0; i < 8; i++) name[i] = ' '; 
+                        int n_idx = 0; 
+                        bool ok = false;
+                        while(true) { 
+                            char c = s_read(); 
+                            if(c == 0 || c == '\r' || c == '\n') break; 
+                            if(c == ',') { ok = true; break; } 
+                            if(n_idx < 8) name[n_idx++] = c; 
+                        }
+                        if(ok) {
+                            uint8_t count = hex2byte(s_read(), s_read()); 
+                            uint8_t *payload = &blk[9];
+                            if(s_read() == ',') {
+                                int n = (count < 22) ? count : 22;
+                                for(int i = 0; i < n; i++) { 
+                                    payload[i] = hex2byte(s_read(), s_read()); 
+                                }
+                                uint16_t base = DEV_MEM_START + (slot * DEV_MEM_SIZE) + DEV_CMD_OFS + (pat * 32);
+                                blk[8] = count;
+#if VM_SNAP
+                                vm_snap_drop();
+#endif
+                                eeprom_write_block(base, blk, 9 + n);   // 32-byte block never crosses a page
+                                print_str("Save Q"); 
+                                print_num(pat); 
+                                print_str("\r\n");
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        else if(cmd == 'F' || cmd == 'f') {
+            if(s_read() == ',' && s_read() == '1' && s_read() == '2' && s_read() == '3' && s_read() == '4') {
+                print_str("--- FMT ---\r\n");
+                uint8_t blank[17];
+                for(int i = 0; i < 17; i++) blank[i] = 0xFF;
+                for(int slot = 3; slot <= 30; slot++) {
+                    uint16_t base = DEV_MEM_START + (slot * DEV_MEM_SIZE); 
+                    eeprom_write_block(base + DEV_LBL_OFS, blank, 17);
+                }
+                slot_titles_top = 0xFF;
+                print_str("--- OK ---\r\n");
+            }
+        }
+        term_len = 0;
+    }
+}
+
+/* --- VM Code Cache --- */
+/* Drops every resident block. Frames the sound interrupt still reads keep
+ * their contents until it lets go of them (vm_cache_victim() skips them). */
+void vm_cache_flush() {
+    for(int i = 0; i < VM_BLOCKS * VM_SPAN_MAX; i++) vm_frame_of[i] = VM_NO_FRAME;
+    for(int f = 0; f < VM_CACHE_PAGES; f++) vm_cache_blk[f] = VM_NO_FRAME;
+    vm_cache_ref = 0;
+    vm_cache_hand = 0;
+}
+
+void vm_cache_reset_stats() {
+    vm_cache_lookups = 0;
+    vm_cache_misses = 0;
+    vm_cache_ticks = 0;
+    vm_cache_stalled = 0;
+    vm_cache_fmiss = 0;
+    vm_cache_fticks = 0;
+    vm_cache_fmiss_max = 0;
+    vm_cache_fticks_max = 0;
+}
+
+/* Clock replacement. The queue is scanned before snd_frame is read, so a
+ * block the interrupt moves from the queue to playing in between is seen. */
+static uint8_t vm_cache_victim() {
+    uint32_t pinned = 0;
+    for(uint8_t t = snd_q_tail; t != snd_q_head; t = (t + 1) & (SND_Q_LEN - 1)) {
+        pinned |= 1UL << snd_q[t].frame;
+    }
+    uint8_t sf = snd_frame;
+    if(sf != VM_NO_FRAME) pinned |= 1UL << sf;
+    for(;;) {
+        uint8_t f = vm_cache_hand;
+        vm_cache_hand = (f + 1 < VM_CACHE_PAGES) ? f + 1 : 0;
+        if(pinned & (1UL << f)) continue;
+        if(vm_cache_ref & (1UL << f)) {
+            vm_cache_ref &= ~(1UL << f);   // Second chance
+            continue;
+        }
+        return f;
+    }
+}
+
+/* --- Packed Cartridges --- */
+/* A packed slot holds, from DEV_CMD_OFS: DEV_PACK_MAGIC, DEV_PACK_VER, the
+ * block count and a big-endian offset from the slot start per block, then
+ * one entry per block in block order. An entry is the block's label, count
+ * byte and payload (at most 22 bytes) as a token stream:
+ *   0x00-0x1F  c + 1 literal bytes follow
+ *   0x20-0x3F  the last byte again, c - 0x1F times
+ *   0x40-0xFF  copy c >> 5 bytes (2..7) from (c & 0x1F) + 1 bytes back
+ * or DEV_PACK_DUP and the number of an earlier block with the same bytes (a
+ * copy cannot be the first token). Copies read the page being written, so
+ * the stream expands straight from the EEPROM into the cache page. The
+ * entries being in order lets launch read the slot as one stream;
+ * pc_upload.py --pack writes the format. */
+
+/* Expands the entry at the open stream into p. Returns the earlier block
+ * named by a DEV_PACK_DUP entry, or VM_NO_FRAME when p holds the block. */
+static uint8_t vm_unpack_stream(uint8_t *p) {
+    uint8_t n = 0;
+    uint8_t end = 9;   // Label and count, then the count is known
+    while(n < end) {
+        uint8_t c = eeprom_stream_next();
+        if(n == 0 && c == DEV_PACK_DUP) return eeprom_stream_next();
+        uint8_t k = (c < 0x20) ? c + 1 : ((c < 0x40) ? c - 0x1F : c >> 5);
+        uint8_t d = (c & 0x1F) + 1;
+        while(k-- > 0 && n < end) {
+            if(c < 0x20) p[n] = eeprom_stream_next();
+            else if(c < 0x40) p[n] = (n > 0) ? p[n - 1] : 0x20;
+            else p[n] = (d <= n) ? p[n - d] : 0x20;
+            n++;
+            if(n == 9) end = 9 + ((p[8] > 22) ? 22 : p[8]);
+        }
+    }
+    return VM_NO_FRAME;
+}
+
+/* EEPROM address of the entry of block blk, from the offset table */
+static uint16_t vm_unpack_addr(uint8_t blk) {
+    uint16_t base = DEV_MEM_START + vm_slot * DEV_MEM_SIZE;
+    uint8_t e[2];
+    eeprom_read_block(base + DEV_CMD_OFS + DEV_PACK_HDR + blk * 2, e, 2);
+    return base + ((e[0] << 8) | e[1]);
+}
+
+static void vm_unpack(uint8_t blk, uint8_t *p) {
+    FT_NEST(FT_EEPROM);
+    while(blk != VM_NO_FRAME) {   // The block a DEV_PACK_DUP names is never one itself
+        eeprom_stream_begin(vm_unpack_addr(blk));
+        blk = vm_unpack_stream(p);
+        eeprom_stream_end();
+    }
+    FT_LEAVE();
+}
+
+/* Bytes past the count read as 0x20 */
+static void vm_blk_pad(uint8_t *p) {
+    uint8_t count = p[8];
+    if(count > 22) count = 22;
+    for(uint8_t j = 9 + count; j < VM_PAGE; j++) p[j] = 0x20;
+}
+
+/* A command block as the VM sees it */
+void vm_blk_load(uint8_t blk, uint8_t *p) {
+    if(vm_packed) vm_unpack(blk, p);
+    else eeprom_read_block(vm_blk_addr(blk), p, VM_PAGE);
+    vm_blk_pad(p);
+}
+
+/* Takes a frame for block blk (not resident); the caller fills it */
+static uint8_t vm_cache_claim(uint8_t blk) {
+    uint8_t f = vm_cache_victim();
+    if(vm_cache_blk[f] != VM_NO_FRAME) vm_frame_of[vm_cache_blk[f]] = VM_NO_FRAME;
+    vm_cache_blk[f] = blk;
+    vm_frame_of[blk] = f;
+    return f;
+}
+
+/* Frame holding block blk (< vm_blocks), read from the EEPROM on a miss */
+uint8_t vm_cache_frame(uint8_t blk) {
+    vm_cache_lookups++;
+    uint8_t f = vm_frame_of[blk];
+    if(f == VM_NO_FRAME) {
+        uint32_t t0 = tick_now();
+        f = vm_cache_claim(blk);
+        vm_blk_load(blk, vm_cache[f]);
+        vm_cache_misses++;
+        vm_cache_fmiss++;
+        vm_cache_fticks += tick_now() - t0;
+    }
+    vm_cache_ref |= 1UL << f;
+    return f;
+}
+
+static inline const uint8_t *vm_cache_page(uint8_t blk) {
+    return vm_cache[vm_cache_frame(blk)];
+}
+
+/* Copies len bytes of the command area from offset ofs (may cross pages) */
+void vm_cache_read(uint16_t ofs, uint8_t *dst, uint8_t len) {
+    while(len > 0) {
+        const uint8_t *p = vm_cache_page(ofs >> 5);
+        uint8_t o = ofs & (VM_PAGE - 1);
+        while(len > 0 && o < VM_PAGE) {
+            *dst++ = p[o++];
+            ofs++;
+            len--;
+        }
+    }
+}
+
+/* Called once per frame: folds the frame's refills into the worst case */
+void vm_cache_frame_end() {
+    if(vm_cache_fmiss > 0) vm_cache_stalled++;
+    if(vm_cache_fmiss > vm_cache_fmiss_max) vm_cache_fmiss_max = vm_cache_fmiss;
+    if(vm_cache_fticks > vm_cache_fticks_max) vm_cache_fticks_max = vm_cache_fticks;
+    vm_cache_ticks += vm_cache_fticks;
+    vm_cache_fmiss = 0;
+    vm_cache_fticks = 0;
+}
+
+/* --- Hardware Utilities --- */
+void sound_init() {
+    RCC->PB1PCENR |= RCC_TIM2EN;
+    RCC->PB2PCENR |= RCC_IOPDEN;
+
+    GPIOD->CFGLR &= ~(0xF << 12);
+    GPIOD->CFGLR |= (0xB << 12); 
+
+    TIM2->PSC = 48 - 1; 
+    TIM2->ATRLR = 1000; 
+    TIM2->CHCTLR1 |= (0x6 << 12) | (1 << 11);   // PWM1, CH2 preload
+    TIM2->CCER |= (1 << 4);       
+    TIM2->CH2CVR = 0;             
+    TIM2->CTLR1 |= TIM_ARPE | TIM_CEN;          // A new period starts cleanly
+
+    RCC->PB2PCENR |= RCC_TIM1EN;
+    TIM1->PSC = 48 - 1;
+    TIM1->ATRLR = 1000000 / SND_TICK_HZ - 1;
+    TIM1->DMAINTENR |= TIM_UIE;
+    TIM1->CTLR1 |= TIM_CEN;
+    NVIC_EnableIRQ(TIM1_UP_IRQn);
+}
+
+/* TIM2 period (1 MHz counts) for a MIDI note; octave 4 table shifted */
+static uint16_t snd_arr(uint8_t note) {
+    static const uint16_t oct4[12] = {
+        3822, 3608, 3405, 3214, 3034, 2863, 2703, 2551, 2408, 2273, 2145, 2025
+    };
+    if(note < 12) note = 12;
+    uint8_t oct = note / 12;
+    uint16_t arr = oct4[note % 12];
+    return (oct >= 5) ? (arr >> (oct - 5)) : (arr << (5 - oct));
+}
+
+static void snd_tone(uint16_t arr) {
+    if(arr == 0) {
+        TIM2->CH2CVR = 0;
+        return;
+    }
+    TIM2->ATRLR = arr;
+    TIM2->CH2CVR = arr / 2;
+}
+
+/* One sequencer tick (TIM1 update, SND_TICK_HZ). Notes are read straight from
+ * the code cache frame: pairs of MIDI note (0 = rest, SND_LOOP = restart) and
+ * length. At most one note is taken per tick, so zero lengths cannot hang it.
+ * snd_frame is released once the last note of a block has been read. */
+void snd_tick() {
+    if(snd_flush) {
+        snd_flush = false;
+        snd_q_tail = snd_flush_to;
+        snd_pos = snd_end;
+        snd_note_ms = 0;
+        snd_frame = VM_NO_FRAME;
+    }
+    uint16_t arr = snd_note_arr;
+    if(snd_note_ms > 0) snd_note_ms--;
+    if(snd_note_ms == 0) {
+        arr = 0;
+        if(snd_pos >= snd_end && snd_q_tail != snd_q_head) {
+            uint8_t t = snd_q_tail;
+            snd_frame = snd_q[t].frame;
+            uint8_t n = vm_cache[snd_frame][8];
+            if(n > 22) n = 22;
+            snd_start = 9;
+            snd_pos = snd_start;
+            snd_end = snd_start + (n & ~1);
+            snd_unit = snd_q[t].unit;
+            snd_q_tail = (t + 1) & (SND_Q_LEN - 1);
+        }
+        if(snd_pos < snd_end) {
+            const uint8_t *p = vm_cache[snd_frame];
+            uint8_t note = p[snd_pos];
+            if(note == SND_LOOP) {
+                snd_pos = snd_start;
+            } else {
+                if(note != 0) arr = snd_arr(note);
+                snd_note_ms = p[snd_pos + 1] * snd_unit;
+                snd_pos += 2;
+            }
+        }
+        if(snd_pos >= snd_end) snd_frame = VM_NO_FRAME;
+    }
+    bool redo = (arr != snd_note_arr);
+    snd_note_arr = arr;
+    if(snd_beep_ms > 0 && --snd_beep_ms == 0) redo = true;   // Back to the melody
+    if(redo && snd_beep_ms == 0) snd_tone(arr);
+}
+
+#ifndef GEMOS_HOST
+void TIM1_UP_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+void TIM1_UP_IRQHandler(void) {
+    TIM1->INTFR = ~TIM_UIF;
+    snd_tick();
+}
+#endif
+
+/* Queues a command block of notes behind the ones playing; false when full.
+ * The block is paged in here, the interrupt never touches the EEPROM. */
+bool snd_play(uint8_t blk, uint8_t unit) {
+    uint8_t next = (snd_q_head + 1) & (SND_Q_LEN - 1);
+    if(next == snd_q_tail) return false;
+    snd_q[snd_q_head].frame = vm_cache_frame(blk);
+    snd_q[snd_q_head].unit = unit;
+    snd_q_head = next;
+    return true;
+}
+
+void snd_stop() {
+    snd_flush_to = snd_q_head;
+    snd_flush = true;
+}
+
+/* Duration in fixed SND_BEEP_MS units, timed by the sequencer tick, so a
+ * BEEP lasts as long with or without frame pacing */
+void beep_start(uint16_t freq, uint16_t duration) {
+    if (freq == 0) return;
+    snd_beep_ms = duration * (SND_BEEP_MS * SND_TICK_HZ / 1000);
+    snd_tone(1000000 / freq);
+}
+
+uint16_t adc_read(uint8_t ch) {
+    ADC1->RSQR3 = ch; 
+    ADC1->CTLR2 |= ADC_SWSTART; 
+    while(!(ADC1->STATR & ADC_EOC));
+    uint16_t dummy = ADC1->RDATAR; 
+    (void)dummy; 
+    ADC1->RSQR3 = ch; 
+    ADC1->CTLR2 |= ADC_SWSTART; 
+    while(!(ADC1->STATR & ADC_EOC));
+    return (uint16_t)ADC1->RDATAR;
+}
+
+/* Clips a w x h region at map index org to the 16 x 16 map (no wrap) and
+ * packs it as (w << 8) | h for the bulk map handlers. */
+static uint16_t vm_map_clip(uint8_t org, uint8_t w, uint8_t h) {
+    uint8_t max_w = 16 - (org & 0x0F);
+    uint8_t max_h = 16 - (org >> 4);
+    if(w > max_w) w = max_w;
+    if(h > max_h) h = max_h;
+    return (w << 8) | h;
+}
+
+/* --- VM Engine (Instruction Decoder) --- */
+/* Decodes one raw instruction at a command-area offset into a record.
+ * Variable indices are pre-masked and branch targets are left as byte
+ * offsets (vm_predecode() rewrites them into record indices). */
+static uint8_t vm_decode_ip(const uint8_t *ip, uint16_t pc, vm_rec_t *r) {
+    uint8_t op = ip[0];
+    r->h = VM_H_NOP;
+    r->a = 0;
+    r->b = 0;
+    r->c = 0;
+    r->t = 0;
+    r->pc = pc;
+    if(op >= VM_EXT_BASE && op < VM_EXT_BASE + VM_EXT_COUNT) {
+        r->h = VM_H_EXT(op);
+    } else if(op < VM_OP_COUNT) {
+        r->h = op;
+    } else {
+        return 1;
+    }
+    switch(op) {
+        case 0x01: case 0x02: case 0x0A: case 0x0F:
+        case 0x10: case 0x11: case 0x12:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2];
+            return 3;
+        case 0x04: case 0x0B: case 0x1C: case 0x1D:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2] & 0x3F;
+            return 3;
+        case 0x05:
+            r->a = ip[1] & 0x3F;
+            return 2;
+        case 0x03: case 0x19:
+            r->a = ip[1] & 0x1F;
+            r->b = ip[2] & 0x3F;
+            r->c = ip[3] & 0x3F;
+            r->t = ip[4];
+            return 5;
+        case 0x06:
+            r->t = (ip[1] << 8) | ip[2];
+            return 3;
+        case 0x07: case 0x0C: case 0x0D: case 0x0E:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2];
+            r->t = (ip[3] << 8) | ip[4];
+            return 5;
+        case 0x13:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2];
+            r->c = ip[3];
+            return 4;
+        case 0x15:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2] & 0x3F;
+            r->c = ip[3] & 0x3F;
+            return 4;
+        case 0x17:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2] & 0x3F;
+            r->c = ip[3] & 0x3F;
+            r->t = (ip[4] << 8) | ip[5];
+            return 6;
+        case 0x18:
+            r->t = (ip[1] << 8) | ip[2];
+            if(r->t < 100) r->t = 400;
+            r->a = ip[3];
+            return 4;
+        case 0x1A:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2] & 0x3F;
+            r->c = ip[3] & 0x3F;
+            r->t = (ip[4] << 8) | ip[5];
+            return 6;
+        case 0x1B:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2];
+            r->c = ip[3];
+            r->t = ip[1] >> 7;  // var | 0x80 = 16-bit pair
+            return 5;
+        case 0x1E:
+            r->t = (ip[1] << 8) | ip[2];
+            return 3;
+        case 0x1F:
+            return 1;
+        case 0x80:
+            r->a = ip[1];
+            r->b = ip[4];
+            r->t = vm_map_clip(ip[1], ip[2], ip[3]);
+            return 5;
+        case 0x81: case 0x83:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2];
+            r->c = ip[5];
+            r->t = vm_map_clip(ip[2], ip[3], ip[4]);
+            return 6;
+        case 0x82:
+            r->a = ip[1];
+            r->b = ip[2];
+            r->t = vm_map_clip(ip[1], ip[3], ip[4]);
+            r->t = vm_map_clip(ip[2], r->t >> 8, r->t & 0xFF);
+            return 5;
+        case 0x84: case 0x85:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2] & 0x3F;
+            r->c = ip[3];
+            r->t = ((ip[4] & 0x3F) << 8) | (ip[5] & 0x3F);
+            return 6;
+        case 0x86: case 0x87:
+            r->a = ip[1] & 0x3F;
+            r->t = (ip[2] << 8) | ip[3];
+            return 4;
+        case 0x88: case 0x89: case 0x8A: case 0x8B: case 0x8C:
+        case 0x8E: case 0x8F:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2] & 0x3F;
+            return 3;
+        case 0x90:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2] & 0x3F;
+            r->c = ip[3] & 0x3F;
+            r->t = ip[4];
+            return 5;
+        case 0x91:
+            r->a = ip[1];
+            r->b = ip[2];
+            return 3;
+        case 0x8D:
+            r->a = ip[1] & 0x3F;
+            r->b = ip[2] & 0x3F;
+            r->c = ip[3];
+            r->t = (ip[4] << 8) | ip[5];
+            return 6;
+        case 0x16:
+            r->h = VM_H_NOP;
+            return 1;
+        default:
+            return 1;
+    }
+}
+
+/* Decodes the instruction at pc from its cache page. Only an instruction
+ * that really runs past the page end brings in the next page, so a short
+ * one at the end of a code block does not page in the data block after it. */
+uint8_t vm_decode(uint16_t pc, vm_rec_t *r) {
+    uint8_t ip[6];   // Longest instruction (JCMP)
+    uint8_t o = pc & (VM_PAGE - 1);
+    uint8_t have = VM_PAGE - o;
+    if(have > 6) have = 6;
+    const uint8_t *p = vm_cache_page(pc >> 5);
+    for(uint8_t i = 0; i < 6; i++) ip[i] = (i < have) ? p[o + i] : 0x20;
+    uint8_t len = vm_decode_ip(ip, pc, r);
+    if(len > have) {
+        vm_cache_read(pc + have, ip + have, 6 - have);
+        len = vm_decode_ip(ip, pc, r);
+    }
+    return len;
+}
+
+/* --- VM Engine (Pre-Decode Pass) --- */
+/* Runs once per app launch over the first slot's command area (or the whole
+ * cartridge when it is shorter). One ascending sweep marks the fall-through
+ * and branch targets of every start it reaches and emits one record per
+ * start, so the fall-through of record N is record N+1. Where a jump lands
+ * inside another instruction a VM_H_LINK record keeps that order intact. A
+ * branch back to a start not seen yet sweeps again from there, decoding
+ * only what it newly reaches. Returns false when the app does not fit VM_REC_MAX, or
+ * when a longer cartridge has code past the first slot; the frame pass then
+ * decodes from the code cache per step. The reachability bitmap borrows
+ * vm_map, which launch clears afterwards. */
+static uint16_t vm_rec_find(uint16_t pc) {
+    uint16_t lo = 0;
+    uint16_t hi = vm_rec_count - 1;
+    if(pc > VM_PC_LIMIT) pc = VM_PC_LIMIT;
+    while(lo < hi) {
+        uint16_t mid = (lo + hi) >> 1;
+        if(vm_recs[mid].pc < pc) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void vm_pd_close() {
+    if(vm_pd_blk != VM_NO_FRAME) eeprom_stream_end();
+    vm_pd_blk = VM_NO_FRAME;
+}
+
+/* Page source of the sweep: blocks arrive through one sequential EEPROM
+ * stream (32 bytes each, or one packed entry each) into the code cache, so
+ * each is read once and the first frames start warm. Only a block behind
+ * the stream or past a gap opens a new one. blk is in the first slot. */
+static const uint8_t *vm_pd_page(uint8_t blk) {
+    uint8_t f = vm_frame_of[blk];
+    if(f != VM_NO_FRAME) {
+        vm_cache_ref |= 1UL << f;
+        return vm_cache[f];
+    }
+    FT_NEST(FT_EEPROM);
+    if(blk != vm_pd_blk) {
+        vm_pd_close();
+        if(!vm_packed) {
+            eeprom_stream_begin(vm_blk_addr(blk));
+        } else if(blk == 0) {
+            eeprom_stream_begin(DEV_MEM_START + vm_slot * DEV_MEM_SIZE + DEV_CMD_OFS + DEV_PACK_HDR + 2 * vm_blocks);
+        } else {
+            eeprom_stream_begin(vm_unpack_addr(blk));
+        }
+        vm_pd_blk = blk;
+    }
+    f = vm_cache_claim(blk);
+    uint8_t *p = vm_cache[f];
+    vm_pd_blk++;
+    if(!vm_packed) {
+        for(uint8_t j = 0; j < VM_PAGE; j++) p[j] = eeprom_stream_next();
+    } else {
+        uint8_t dup = vm_unpack_stream(p);
+        if(dup != VM_NO_FRAME) {
+            uint8_t g = vm_frame_of[dup];
+            if(g != VM_NO_FRAME) {
+                memcpy(p, vm_cache[g], VM_PAGE);
+            } else {
+                vm_pd_close();   // The stream cannot be paused for another read
+                vm_unpack(dup, p);
+            }
+        }
+    }
+    vm_blk_pad(p);
+    vm_cache_ref |= 1UL << f;
+    FT_LEAVE();
+    return p;
+}
+
+/* vm_decode() on vm_pd_page() pages */
+static uint8_t vm_pd_decode(uint16_t pc, vm_rec_t *r) {
+    uint8_t ip[6];
+    uint8_t o = pc & (VM_PAGE - 1);
+    const uint8_t *p = vm_pd_page(pc >> 5);
+    for(uint8_t i = 0; i < 6; i++) ip[i] = (o + i < VM_PAGE) ? p[o + i] : 0x20;
+    uint8_t len = vm_decode_ip(ip, pc, r);
+    if(o + len > VM_PAGE) {
+        p = vm_pd_page((pc >> 5) + 1);
+        for(uint8_t i = VM_PAGE - o; i < 6; i++) ip[i] = p[i - (VM_PAGE - o)];
+        len = vm_decode_ip(ip, pc, r);
+    }
+    return len;
+}
+
+#define VM_MARKED(pc) (mark[(pc) >> 3] & (1 << ((pc) & 7)))
+#define VM_MARK(pc)   (mark[(pc) >> 3] |= (1 << ((pc) & 7)))
+#define VM_PD_NONE    0xFFFF
+#define VM_PD_PC      0x0FFF   // pc bits of a record; the length sits above until the end
+
+bool vm_predecode() {
+    uint8_t *mark = vm_map;
+    bool longer = (vm_pc_limit > VM_PC_LIMIT);   // Records cover the first slot only
+    uint16_t lim = longer ? VM_PC_LIMIT : vm_pc_limit;
+    uint16_t last = 0;      // Highest start marked so far
+    uint16_t from = 0;      // Start of the sweep
+    uint16_t n = 0;
+    bool ok = true;
+    for(int i = 0; i < 256; i++) mark[i] = 0;
+    VM_MARK(0);
+    vm_pd_blk = VM_NO_FRAME;
+
+    /* Records stay sorted by pc. A sweep decodes the marked starts that have
+     * no record yet, so one behind it only costs the chain it opens. */
+    while(ok) {
+        uint16_t back = VM_PD_NONE;   // Lowest start marked behind the sweep
+        uint16_t at = 0;              // First record at or after pc
+        while(at < n && (vm_recs[at].pc & VM_PD_PC) < from) at++;
+        for(uint16_t pc = from; pc <= last && pc < lim; pc++) {
+            if(!VM_MARKED(pc)) continue;
+            while(at < n && (vm_recs[at].pc & VM_PD_PC) < pc) at++;
+            if(at < n && (vm_recs[at].pc & VM_PD_PC) == pc) continue;
+            if(n >= VM_REC_MAX - 1) {
+                ok = false;
+                break;
+            }
+            vm_rec_t r;
+            uint8_t len = vm_pd_decode(pc, &r);
+            uint16_t next = pc + len;
+            r.pc = pc | (len << 12);
+            memmove(&vm_recs[at + 1], &vm_recs[at], (n - at) * sizeof(vm_rec_t));
+            vm_recs[at++] = r;
+            n++;
+            if(VM_IS_BRANCH(r.h) && r.t < lim && !VM_MARKED(r.t)) {
+                VM_MARK(r.t);
+                if(r.t < pc && r.t < back) back = r.t;
+                if(r.t > last) last = r.t;
+            } else if(VM_IS_BRANCH(r.h) && longer && r.t >= lim && r.t < vm_pc_limit) {
+                ok = false;
+                break;
+            }
+            if(!VM_NO_FALL(r.h) && next < lim) {
+                VM_MARK(next);
+                if(next > last) last = next;
+            } else if(!VM_NO_FALL(r.h) && longer && next < vm_pc_limit) {
+                ok = false;
+                break;
+            }
+        }
+        if(back == VM_PD_NONE) break;
+        from = back;
+    }
+    vm_pd_close();
+
+    /* A start that falls into the middle of the next one (a jump landed
+     * inside it) gets a VM_H_LINK record to its real successor */
+    uint16_t links = 0;
+    for(uint16_t i = 0; ok && i + 1 < n; i++) {
+        uint16_t next = (vm_recs[i].pc & VM_PD_PC) + (vm_recs[i].pc >> 12);
+        if(!VM_NO_FALL(vm_recs[i].h) && next != (vm_recs[i + 1].pc & VM_PD_PC)) links++;
+    }
+    if(!ok || n + links >= VM_REC_MAX) {
+        vm_rec_count = 0;
+        return false;
+    }
+    uint16_t succ = lim;   // Start after record i
+    for(uint16_t i = n, j = n + links; i-- > 0;) {
+        vm_rec_t r = vm_recs[i];
+        uint16_t pc = r.pc & VM_PD_PC;
+        uint16_t next = pc + (r.pc >> 12);
+        if(!VM_NO_FALL(r.h) && next != succ && succ < lim) {
+            vm_recs[--j].h = VM_H_LINK;
+            vm_recs[j].t = next;
+            vm_recs[j].pc = pc;
+        }
+        r.pc = pc;
+        vm_recs[--j] = r;
+        succ = pc;
+    }
+    n += links;
+    vm_recs[n].h = VM_H_HALT;
+    vm_recs[n].t = 0;
+    vm_recs[n].pc = lim;
+    n++;
+    vm_rec_count = n;
+
+    for(uint16_t i = 0; i < n; i++) {
+        uint8_t h = vm_recs[i].h;
+        if(h == VM_H_LINK || (h < VM_H_COUNT && VM_IS_BRANCH(h))) {
+            vm_recs[i].t = vm_rec_find(vm_recs[i].t);
+        }
+    }
+    return true;
+}
+
+/* --- VM 16-bit Pairs --- */
+/* A pair is vm_vars[v] (low) and vm_vars[v + 1] (high); v = 63 wraps to 0. */
+static inline uint16_t vm_get16(uint8_t v) {
+    return vm_vars[v] | (vm_vars[(v + 1) & 0x3F] << 8);
+}
+
+static inline void vm_set16(uint8_t v, uint16_t val) {
+    vm_vars[v] = val & 0xFF;
+    vm_vars[(v + 1) & 0x3F] = val >> 8;
+}
+
+/* --- VM Rect Broadphase --- */
+static uint8_t vm_rband(uint16_t v, uint8_t n) {
+    v >>= 4;
+    return (v < n) ? v : n - 1;
+}
+
+/* Adds (on) or removes rect id from the bands it covers. A zero height is
+ * indexed as 1 so the mask stays a superset of what 0x1A would hit. */
+static void vm_rect_mark(uint8_t id, bool on) {
+    uint8_t *rc = vm_rects[id];
+    if(rc[2] == 0) return;   // Width 0 = inactive, never indexed
+    uint64_t bit = 1ULL << id;
+    uint8_t x1 = vm_rband(rc[0] + rc[2] - 1, VM_RBAND_X);
+    uint8_t y1 = vm_rband(rc[1] + (rc[3] ? rc[3] : 1) - 1, VM_RBAND_Y);
+    for(uint8_t b = vm_rband(rc[0], VM_RBAND_X); b <= x1; b++) {
+        if(on) vm_rband_x[b] |= bit; else vm_rband_x[b] &= ~bit;
+    }
+    for(uint8_t b = vm_rband(rc[1], VM_RBAND_Y); b <= y1; b++) {
+        if(on) vm_rband_y[b] |= bit; else vm_rband_y[b] &= ~bit;
+    }
+}
+
+static void vm_rect_unindex_all(void) {
+    for(int i = 0; i < VM_RBAND_X; i++) vm_rband_x[i] = 0;
+    for(int i = 0; i < VM_RBAND_Y; i++) vm_rband_y[i] = 0;
+}
+
+/* --- VM Engine (Opcode Handlers) --- */
+/* Handlers work on decoded records and return VM_NEXT, VM_JUMP (continue at
+ * r->t), VM_YIELD (advance, then end the frame), VM_CALL or VM_RET. */
+typedef uint8_t (*vm_op_fn)(const vm_rec_t *r);
+
+static uint8_t vm_op_nop(const vm_rec_t *r) {
+    (void)r;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_set(const vm_rec_t *r) {
+    vm_vars[r->a] = r->b; 
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_add(const vm_rec_t *r) {
+    vm_vars[r->a] += r->b; 
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_sprite_char(const vm_rec_t *r) {
+    vm_sprites[r->a][0] = vm_vars[r->b];
+    vm_sprites[r->a][1] = vm_vars[r->c];
+    vm_sprites[r->a][2] = 1;
+    vm_sprites[r->a][3] = (uint8_t)r->t;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_joy(const vm_rec_t *r) {
+    vm_vars[r->a] = (vm_in_dx > 0) ? 1 : ((vm_in_dx < 0) ? 255 : 0);
+    vm_vars[r->b] = (vm_in_dy > 0) ? 1 : ((vm_in_dy < 0) ? 255 : 0);
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_button(const vm_rec_t *r) {
+    vm_vars[r->a] = vm_in_btn;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_jmp(const vm_rec_t *r) {
+    (void)r;
+    return VM_JUMP;
+}
+
+static uint8_t vm_op_jeq(const vm_rec_t *r) {
+    return (vm_vars[r->a] == r->b) ? VM_JUMP : VM_NEXT;
+}
+
+static uint8_t vm_op_beep_short(const vm_rec_t *r) {
+    (void)r;
+    beep_start(2000, 10); 
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_yield(const vm_rec_t *r) {
+    (void)r;
+    return VM_YIELD;
+}
+
+static uint8_t vm_op_sub(const vm_rec_t *r) {
+    vm_vars[r->a] -= r->b; 
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_mouse(const vm_rec_t *r) {
+    vm_vars[r->a] = mouse_x;
+    vm_vars[r->b] = mouse_y;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_jgt(const vm_rec_t *r) {
+    return (vm_vars[r->a] > r->b) ? VM_JUMP : VM_NEXT;
+}
+
+static uint8_t vm_op_jlt(const vm_rec_t *r) {
+    return (vm_vars[r->a] < r->b) ? VM_JUMP : VM_NEXT;
+}
+
+static uint8_t vm_op_jne(const vm_rec_t *r) {
+    return (vm_vars[r->a] != r->b) ? VM_JUMP : VM_NEXT;
+}
+
+static uint8_t vm_op_rand(const vm_rec_t *r) {
+    uint8_t seed = vm_rng_seed;
+    seed ^= (seed << 3); seed ^= (seed >> 5); seed ^= (seed << 4);
+    vm_rng_seed = seed;
+    vm_vars[r->a] = (r->b > 0) ? (seed % r->b) : 0;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_mul(const vm_rec_t *r) {
+    vm_vars[r->a] *= r->b;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_div(const vm_rec_t *r) {
+    if(r->b != 0) vm_vars[r->a] /= r->b;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_mod(const vm_rec_t *r) {
+    if(r->b != 0) vm_vars[r->a] %= r->b;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_clamp(const vm_rec_t *r) {
+    vm_vars[r->a] = constrain(vm_vars[r->a], r->b, r->c);
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_clear(const vm_rec_t *r) {
+    (void)r;
+    for(int i = 0; i < 32; i++) vm_sprites[i][2] = 0;
+    for(int i = 0; i < 64; i++) vm_rects[i][2] = 0;
+    for(int i = 0; i < 256; i++) vm_map[i] = 0;
+    vm_rect_unindex_all();
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_rect(const vm_rec_t *r) {
+    vm_rect_mark(r->a, false);
+    vm_rects[r->a][0] = vm_vars[r->b];
+    vm_rects[r->a][1] = vm_vars[r->c];
+    vm_rects[r->a][2] = 1;
+    vm_rects[r->a][3] = 1;
+    vm_rect_mark(r->a, true);
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_rect_size(const vm_rec_t *r) {
+    vm_rect_mark(r->a, false);
+    vm_rects[r->a][0] = vm_vars[r->b];
+    vm_rects[r->a][1] = vm_vars[r->c];
+    vm_rects[r->a][2] = r->t >> 8;
+    vm_rects[r->a][3] = r->t & 0xFF;
+    vm_rect_mark(r->a, true);
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_beep(const vm_rec_t *r) {
+    beep_start(r->t, r->a); 
+    return VM_NEXT;
+}
+
+/* Notes: pairs of MIDI note and length in b ms steps; b = 0 stops the music */
+static uint8_t vm_op_melody(const vm_rec_t *r) {
+    if(r->b == 0) snd_stop();
+    else if(r->a < vm_blocks) snd_play(r->a, r->b);
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_sprite_bmp(const vm_rec_t *r) {
+    vm_sprites[r->a][0] = vm_vars[r->b];
+    vm_sprites[r->a][1] = vm_vars[r->c];
+    vm_sprites[r->a][2] = 2; 
+    vm_sprites[r->a][3] = (uint8_t)r->t; 
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_hit(const vm_rec_t *r) {
+    uint8_t vx = vm_vars[r->a];
+    uint8_t vy = vm_vars[r->b];
+    uint8_t rx = vm_rects[r->c][0];
+    uint8_t ry = vm_rects[r->c][1];
+    uint8_t rw = vm_rects[r->c][2];
+    uint8_t rh = vm_rects[r->c][3];
+    if (rw > 0 && (vx + 2) >= rx && vx < rx + rw && (vy + 2) >= ry && vy < ry + rh) {
+        return VM_JUMP;
+    }
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_number(const vm_rec_t *r) {
+    if (vm_num_count < 8) {
+        vm_numbers[vm_num_count][0] = r->t ? vm_get16(r->a) : vm_vars[r->a];
+        vm_numbers[vm_num_count][1] = r->b;
+        vm_numbers[vm_num_count][2] = r->c;
+        vm_num_count++;
+    }
+    return VM_NEXT; 
+}
+
+static uint8_t vm_op_map_write(const vm_rec_t *r) {
+    vm_map[vm_vars[r->a]] = vm_vars[r->b];
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_map_read(const vm_rec_t *r) {
+    vm_vars[r->b] = vm_map[vm_vars[r->a]];
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_call(const vm_rec_t *r) {
+    (void)r;
+    return VM_CALL;
+}
+
+static uint8_t vm_op_ret(const vm_rec_t *r) {
+    (void)r;
+    return VM_RET;
+}
+
+/* Bulk map handlers: r->t is the region already clipped by vm_decode */
+static uint8_t vm_op_map_fill(const vm_rec_t *r) {
+    uint8_t *row = &vm_map[r->a];
+    for(uint8_t y = 0; y < (r->t & 0xFF); y++, row += 16) {
+        for(uint8_t x = 0; x < (r->t >> 8); x++) row[x] = r->b;
+    }
+    return VM_NEXT;
+}
+
+/* Counts the cells equal to val. A full 16 x 16 match gives 256, which
+ * saturates at 255 instead of wrapping to 0. */
+static uint8_t vm_op_map_count(const vm_rec_t *r) {
+    const uint8_t *row = &vm_map[r->b];
+    uint16_t n = 0;
+    for(uint8_t y = 0; y < (r->t & 0xFF); y++, row += 16) {
+        for(uint8_t x = 0; x < (r->t >> 8); x++) {
+            if(row[x] == r->c) n++;
+        }
+    }
+    vm_vars[r->a] = (n > 255) ? 255 : n;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_map_copy(const vm_rec_t *r) {
+    uint8_t w = r->t >> 8;
+    uint8_t h = r->t & 0xFF;
+    if(w == 0 || h == 0) return VM_NEXT;
+    if(r->a > r->b) {
+        /* Destination after source: copy backwards so overlaps stay intact */
+        for(int y = h - 1; y >= 0; y--) {
+            for(int x = w - 1; x >= 0; x--) vm_map[r->a + y * 16 + x] = vm_map[r->b + y * 16 + x];
+        }
+    } else {
+        for(int y = 0; y < h; y++) {
+            for(int x = 0; x < w; x++) vm_map[r->a + y * 16 + x] = vm_map[r->b + y * 16 + x];
+        }
+    }
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_map_find(const vm_rec_t *r) {
+    uint8_t idx = r->b;
+    for(uint8_t y = 0; y < (r->t & 0xFF); y++, idx += 16) {
+        for(uint8_t x = 0; x < (r->t >> 8); x++) {
+            if(vm_map[(uint8_t)(idx + x)] == r->c) {
+                vm_vars[r->a] = idx + x;
+                return VM_NEXT;
+            }
+        }
+    }
+    vm_vars[r->a] = 0xFF;
+    return VM_NEXT;
+}
+
+/* Ray scan: walks from the cell in idxvar by a signed step (dx + 16 * dy,
+ * |dx| <= 7; the split gives dx -8..7, so step 8 runs as dx -8, dy +1 and
+ * gemc.py refuses |dx| = 8) and counts opp tiles up to an own tile. A run
+ * that hits any other tile or leaves the 16 x 16 map counts as 0. With
+ * flip set the counted cells are overwritten with own. */
+static uint8_t vm_ray(const vm_rec_t *r, bool flip) {
+    int8_t step = (int8_t)r->c;
+    int8_t dy = (step + 8) >> 4;
+    int8_t dx = step - dy * 16;
+    uint8_t own = vm_vars[r->t >> 8];
+    uint8_t opp = vm_vars[r->t & 0xFF];
+    uint8_t start = vm_vars[r->b];
+    int8_t x = start & 0x0F;
+    int8_t y = start >> 4;
+    uint8_t n = 0;
+    if(step != 0) {
+        while(true) {
+            x += dx;
+            y += dy;
+            if(x < 0 || x > 15 || y < 0 || y > 15) {
+                n = 0;
+                break;
+            }
+            uint8_t tile = vm_map[(y << 4) | x];
+            if(tile == opp) {
+                n++;
+                continue;
+            }
+            if(tile != own) n = 0;
+            break;
+        }
+    }
+    if(flip) {
+        uint8_t idx = start;
+        for(uint8_t i = 0; i < n; i++) {
+            idx += step;
+            vm_map[idx] = own;
+        }
+    }
+    vm_vars[r->a] = n;
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_ray_scan(const vm_rec_t *r) {
+    return vm_ray(r, false);
+}
+
+static uint8_t vm_op_ray_flip(const vm_rec_t *r) {
+    return vm_ray(r, true);
+}
+
+static uint8_t vm_op_set16(const vm_rec_t *r) {
+    vm_set16(r->a, r->t);
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_add16(const vm_rec_t *r) {
+    vm_set16(r->a, vm_get16(r->a) + r->t);
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_mov(const vm_rec_t *r) {
+    vm_vars[r->a] = vm_vars[r->b];
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_addv(const vm_rec_t *r) {
+    vm_vars[r->a] += vm_vars[r->b];
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_subv(const vm_rec_t *r) {
+    vm_vars[r->a] -= vm_vars[r->b];
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_addv16(const vm_rec_t *r) {
+    vm_set16(r->a, vm_get16(r->a) + vm_get16(r->b));
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_subv16(const vm_rec_t *r) {
+    vm_set16(r->a, vm_get16(r->a) - vm_get16(r->b));
+    return VM_NEXT;
+}
+
+/* r->c: 0 = EQ, 1 = NE, 2 = LT, 3 = GT (unsigned), +4 = compare pairs */
+static uint8_t vm_op_jcmp(const vm_rec_t *r) {
+    uint16_t x = (r->c & 4) ? vm_get16(r->a) : vm_vars[r->a];
+    uint16_t y = (r->c & 4) ? vm_get16(r->b) : vm_vars[r->b];
+    bool hit;
+    switch(r->c & 3) {
+        case 0:  hit = (x == y); break;
+        case 1:  hit = (x != y); break;
+        case 2:  hit = (x < y); break;
+        default: hit = (x > y); break;
+    }
+    return hit ? VM_JUMP : VM_NEXT;
+}
+
+static uint8_t vm_op_loadi(const vm_rec_t *r) {
+    vm_vars[r->a] = vm_vars[vm_vars[r->b] & 0x3F];
+    return VM_NEXT;
+}
+
+static uint8_t vm_op_storei(const vm_rec_t *r) {
+    vm_vars[vm_vars[r->a] & 0x3F] = vm_vars[r->b];
+    return VM_NEXT;
+}
+
+/* Box (x, y) .. (x + size, y + size) against every active rect, same test
+ * as 0x1A (size 2 = the 0x1A point). var = lowest hit id, 0xFF = none. */
+static uint8_t vm_op_rect_find(const vm_rec_t *r) {
+    uint8_t vx = vm_vars[r->b];
+    uint8_t vy = vm_vars[r->c];
+    uint8_t s = r->t;
+    uint64_t mx = 0;
+    uint64_t my = 0;
+    uint8_t b1 = vm_rband(vx + s, VM_RBAND_X);
+    for(uint8_t b = vm_rband(vx, VM_RBAND_X); b <= b1; b++) mx |= vm_rband_x[b];
+    b1 = vm_rband(vy + s, VM_RBAND_Y);
+    for(uint8_t b = vm_rband(vy, VM_RBAND_Y); b <= b1; b++) my |= vm_rband_y[b];
+    uint64_t m = mx & my;
+    uint8_t hit = 0xFF;
+    while(m) {
+        uint8_t id = __builtin_ctzll(m);
+        uint8_t *rc = vm_rects[id];
+        if((vx + s) >= rc[0] && vx < rc[0] + rc[2] && (vy + s) >= rc[1] && vy < rc[1] + rc[3]) {
+            hit = id;
+            break;
+        }
+        m &= m - 1;
+    }
+    vm_vars[r->a] = hit;
+    return VM_NEXT;
+}
+
+static const vm_op_fn vm_op_table[VM_H_COUNT] = {
+    vm_op_nop,         // 0x00 NOP
+    vm_op_set,         // 0x01 SET       var, imm
+    vm_op_add,         // 0x02 ADD       var, imm
+    vm_op_sprite_char, // 0x03 SPRITE    id, xvar, yvar, char
+    vm_op_joy,         // 0x04 JOYSTICK  xvar, yvar
+    vm_op_button,      // 0x05 BUTTON    var
+    vm_op_jmp,         // 0x06 JMP       addr16
+    vm_op_jeq,         // 0x07 JEQ       var, imm, addr16
+    vm_op_beep_short,  // 0x08 BEEP_SHORT
+    vm_op_yield,       // 0x09 FRAME (yield)
+    vm_op_sub,         // 0x0A SUB       var, imm
+    vm_op_mouse,       // 0x0B CURSOR    xvar, yvar
+    vm_op_jgt,         // 0x0C JGT       var, imm, addr16
+    vm_op_jlt,         // 0x0D JLT       var, imm, addr16
+    vm_op_jne,         // 0x0E JNE       var, imm, addr16
+    vm_op_rand,        // 0x0F RANDOM    var, max
+    vm_op_mul,         // 0x10 MUL       var, imm
+    vm_op_div,         // 0x11 DIV       var, imm
+    vm_op_mod,         // 0x12 MOD       var, imm
+    vm_op_clamp,       // 0x13 CLAMP     var, lo, hi
+    vm_op_clear,       // 0x14 CLEAR
+    vm_op_rect,        // 0x15 RECT      id, xvar, yvar (1x1)
+    vm_op_nop,         // 0x16 (unused)
+    vm_op_rect_size,   // 0x17 RECT      id, xvar, yvar, w, h
+    vm_op_beep,        // 0x18 BEEP      freq16, dur
+    vm_op_sprite_bmp,  // 0x19 SPRITE    id, xvar, yvar, bitmap
+    vm_op_hit,         // 0x1A HIT       xvar, yvar, rect, addr16
+    vm_op_number,      // 0x1B NUMBER    var (| 0x80 = pair), x, y
+    vm_op_map_write,   // 0x1C MAP_WRITE idxvar, valvar
+    vm_op_map_read,    // 0x1D MAP_READ  idxvar, valvar
+    vm_op_call,        // 0x1E CALL      addr16
+    vm_op_ret,         // 0x1F RET
+    vm_op_map_fill,    // 0x80 MAP_FILL  org, w, h, val
+    vm_op_map_count,   // 0x81 MAP_COUNT var, org, w, h, val
+    vm_op_map_copy,    // 0x82 MAP_COPY  dst, src, w, h
+    vm_op_map_find,    // 0x83 MAP_FIND  var, org, w, h, val  (0xFF = none)
+    vm_op_ray_scan,    // 0x84 RAY_SCAN  var, idxvar, step, ownvar, oppvar
+    vm_op_ray_flip,    // 0x85 RAY_FLIP  var, idxvar, step, ownvar, oppvar
+    vm_op_set16,       // 0x86 SET16     pair, imm16
+    vm_op_add16,       // 0x87 ADD16     pair, imm16 (0xFFFF = -1)
+    vm_op_mov,         // 0x88 MOV       dst, src
+    vm_op_addv,        // 0x89 ADDV      dst, src
+    vm_op_subv,        // 0x8A SUBV      dst, src
+    vm_op_addv16,      // 0x8B ADDV16    dstpair, srcpair
+    vm_op_subv16,      // 0x8C SUBV16    dstpair, srcpair
+    vm_op_jcmp,        // 0x8D JCMP      a, b, cond, addr16
+    vm_op_loadi,       // 0x8E LOADI     dst, idxvar   (dst = vars[vars[idx]])
+    vm_op_storei,      // 0x8F STOREI    idxvar, src   (vars[vars[idx]] = src)
+    vm_op_rect_find,   // 0x90 RECT_FIND var, xvar, yvar, size (0xFF = no hit)
+    vm_op_melody       // 0x91 MELODY    blk, unit ms (0 = stop)
+};
+
+/* --- VM Display List --- */
+/* Pages p with y <= 8p + 7 and y + h - 1 >= 8p, the test the draw functions
+ * make on every pass. h = 0 gives y - 1 like draw_window(). */
+static uint8_t vm_dl_pages(uint8_t y, uint8_t h) {
+    int16_t lo = y >> 3;
+    int16_t hi = (y + h - 1) >> 3;
+    if(hi > 7) hi = 7;
+    if(lo > hi) return 0;
+    return (uint8_t)((0xFF >> (7 - hi)) & (0xFF << lo));
+}
+
+void vm_dl_build() {
+    for(int p = 0; p < 8; p++) {
+        vm_dl_sprites[p] = 0;
+        vm_dl_rects[p] = 0;
+        vm_dl_numbers[p] = 0;
+    }
+    for(uint8_t i = 0; i < 32; i++) {
+        uint8_t type = vm_sprites[i][2];
+        if(type != 1 && !(type == 2 && vm_sprites[i][3] < vm_blocks)) continue;
+        for(uint8_t m = vm_dl_pages(vm_sprites[i][1], 8); m; m &= m - 1) {
+            vm_dl_sprites[__builtin_ctz(m)] |= 1UL << i;
         }
-        else if (cmd == 'D' || cmd == 'd') {
-            if(s_read() == ',') {
-                int slot = (s_read() - '0') * 10 + (s_read() - '0');
-                if(slot >= 0 && slot <= 30) {
-                    print_str("\r\n--- DUMP S"); print_num(slot); print_str(" ---\r\n");
-                    uint16_t base = DEV_MEM_START + (slot * DEV_MEM_SIZE);
-                    for(int i = 0; i < DEV_MEM_SIZE; i += 16) {
-                        print_hex((i >> 8) & 0xFF); print_hex(i & 0xFF); print_str(" : ");
-                        for(int j = 0; j < 16; j++) {
-                            print_hex(eeprom_read_byte(base + i + j)); print_str(" ");
-                        }
-                        print_str("\r\n");
-                    }
-                    print_str("\r\nPress ANY KEY to return...");
-                    while(true) { if(s_read() != 0) break; }
-                    show_dashboard();
-                }
-            }
+    }
+    for(uint8_t i = 0; i < 64; i++) {
+        if(vm_rects[i][2] == 0) continue;
+        for(uint8_t m = vm_dl_pages(vm_rects[i][1], vm_rects[i][3]); m; m &= m - 1) {
+            vm_dl_rects[__builtin_ctz(m)] |= 1ULL << i;
         }
-        else if (cmd == 'E' || cmd == 'e') {
-            *pc_link_mode_ptr = false;
-            print_str("\r\n--- PC LINK OFF ---\r\n");
+    }
+    for(uint8_t i = 0; i < vm_num_count; i++) {
+        for(uint8_t m = vm_dl_pages((uint8_t)vm_numbers[i][2], 8); m; m &= m - 1) {
+            vm_dl_numbers[__builtin_ctz(m)] |= 1 << i;
         }
-        else if(cmd == 'V' || cmd == 'v') {
-            if(s_read() == ',') {
-                uint8_t maj = hex2byte(s_read(), s_read());
-                if(s_read() == ',') {
-                    uint8_t min = hex2byte(s_read(), s_read());
-                    eeprom_write_byte(1, maj);
-                    eeprom_write_byte(2, min);
-                    app_ver_major = maj;
-                    app_ver_minor = min;
-                    print_str("Save VER\r\n");
-                }
-            }
+    }
+}
+
+/* --- VM Engine (1 Frame Pass) --- */
+static inline void vm_trace_push(uint16_t pc) {
+    vm_trace[vm_trace_idx] = DEV_CMD_OFS + pc;
+    vm_trace_idx = (vm_trace_idx + 1) & 0x0F;
+    last_vm_pc = DEV_CMD_OFS + pc;
+#if VM_PROF
+    uint16_t b = pc >> 5;   // Blocks of DEV_ID_CONT slots are not counted
+    if(b < VM_BLOCKS && ++vm_prof_hits[b] == 0xFFFF) {
+        /* Halve everything so the ratios between blocks survive */
+        for(int i = 0; i < VM_BLOCKS; i++) vm_prof_hits[i] >>= 1;
+        vm_prof_shift++;
+    }
+#endif
+}
+
+/* CALL pushes ret and continues at dst, RET pops into *next. A full or empty
+ * stack stops the app; the fault and its PC show up in the T command. */
+static bool vm_call_ret(uint8_t res, uint16_t pc, uint16_t ret, uint16_t dst, uint16_t *next) {
+    if(res == VM_CALL) {
+        if(vm_call_sp < VM_CALL_DEPTH) {
+            vm_call_stack[vm_call_sp++] = ret;
+            *next = dst;
+            return true;
         }
-        else if(cmd == 'W' || cmd == 'w') {
-            if(s_read() == ',') {
-                int slot = (s_read() - '0') * 10 + (s_read() - '0');
-                if(s_read() == ',' && slot >= 0 && slot <= 30) {
-                    uint8_t id = hex2byte(s_read(), s_read());
-                    if(s_read() == ',') {
-                        char name[16]; 
-                        for(int i = 0; i < 16; i++) name[i] = ' '; 
-                        int n_idx = 0;
-                        while(true) { 
-                            char c = s_read(); 
-                            if(c == 0 || c == '\r' || c == '\n') break; 
-                            if(n_idx < 16) name[n_idx++] = c; 
-                        }
-                        uint16_t base = DEV_MEM_START + (slot * DEV_MEM_SIZE); 
-                        eeprom_write_byte(base + DEV_ID_OFS, id);
-                        for(int i = 0; i < 16; i++) {
-                            eeprom_write_byte(base + DEV_LBL_OFS + i, name[i]);
-                        }
-                        print_str("Save S"); 
-                        print_num(slot); 
-                        print_str("\r\n");
-                    }
-                }
-            }
+        vm_fault = VM_FAULT_OVF;
+    } else {
+        if(vm_call_sp > 0) {
+            *next = vm_call_stack[--vm_call_sp];
+            return true;
         }
-        else if(cmd == 'S' || cmd == 's') {
-            if(s_read() == ',') {
-                int slot = (s_read() - '0') * 10 + (s_read() - '0');
-                if(s_read() == ',' && slot >= 0 && slot <= 30) {
-                    int pat = (s_read() - '0') * 10 + (s_read() - '0');
-                    if(s_read() == ',' && pat >= 0 && pat <= 58) {
-                        char name[8]; 
-                        for(int i = 0; i < 8; i++) name[i] = ' '; 
-                        int n_idx = 0; 
-                        bool ok = false;
-                        while(true) { 
-                            char c = s_read(); 
-                            if(c == 0 || c == '\r' || c == '\n') break; 
-                            if(c == ',') { ok = true; break; } 
-                            if(n_idx < 8) name[n_idx++] = c; 
-                        }
-                        if(ok) {
-                            uint8_t count = hex2byte(s_read(), s_read()); 
-                            uint8_t payload[22];
-                            if(s_read() == ',') {
-                                for(int i = 0; i < count && i < 22; i++) { 
-                                    payload[i] = hex2byte(s_read(), s_read()); 
-                                }
-                                uint16_t base = DEV_MEM_START + (slot * DEV_MEM_SIZE) + DEV_CMD_OFS + (pat * 32);
-                                for(int i = 0; i < 8; i++) {
-                                    eeprom_write_byte(base + i, name[i]); 
-                                }
-                                eeprom_write_byte(base + 8, count);
-                                for(int i = 0; i < count && i < 22; i++) {
-                                    eeprom_write_byte(base + 9 + i, payload[i]);
-                                }
-                                print_str("Save Q"); 
-                                print_num(pat); 
-                                print_str("\r\n");
-                            }
-                        }
-                    }
+        vm_fault = VM_FAULT_UNF;
+    }
+    vm_fault_pc = DEV_CMD_OFS + pc;
+    vm_running = false;
+    return false;
+}
+
+#if VM_SCHED_TIME
+#define VM_BUDGET_LEFT() ((tick_now() - frame_t0) < vm_budget_ticks)
+#else
+#define VM_BUDGET_LEFT() (true)
+#endif
+
+void vm_run_frame() {
+    vm_cache_frame_end();   // Refills of the last frame, its render included
+    vm_num_count = 0;
+#if VM_SCHED_TIME || VM_BENCH
+    uint32_t frame_t0 = tick_now();
+#endif
+    uint8_t res = VM_NEXT;
+    int runaway = 0;
+    if(vm_rec_count > 0) {
+        /* Decoded path: records are executed in place, no operand decoding */
+        while(runaway < VM_OP_LIMIT && VM_BUDGET_LEFT()) {
+            const vm_rec_t *r = &vm_recs[vm_ip];
+            if(r->h >= VM_H_LINK) {
+                if(r->h == VM_H_HALT) {
+                    vm_running = false;
+                    break;
                 }
+                vm_ip = r->t;
+                continue;
+            }
+            runaway++;
+            vm_trace_push(r->pc);
+#if VM_BENCH
+            uint32_t t0 = tick_now();
+            res = vm_op_table[r->h](r);
+            vm_bench_ticks[r->h] += tick_now() - t0;
+            vm_bench_hits[r->h]++;
+#else
+            res = vm_op_table[r->h](r);
+#endif
+            if(res == VM_JUMP) {
+                vm_ip = r->t;
+            } else if(res >= VM_CALL) {
+                if(!vm_call_ret(res, r->pc, vm_ip + 1, r->t, &vm_ip)) break;
+            } else {
+                vm_ip++;
+                if(res == VM_YIELD) break;
             }
         }
-        else if(cmd == 'F' || cmd == 'f') {
-            if(s_read() == ',' && s_read() == '1' && s_read() == '2' && s_read() == '3' && s_read() == '4') {
-                print_str("--- FMT ---\r\n");
-                for(int slot = 3; slot <= 30; slot++) {
-                    uint16_t base = DEV_MEM_START + (slot * DEV_MEM_SIZE); 
-                    eeprom_write_byte(base + DEV_ID_OFS, 0xFF);
-                    for(int i = 0; i < 16; i++) {
-                        eeprom_write_byte(base + DEV_LBL_OFS + i, 0xFF);
-                    }
-                }
-                print_str("--- OK ---\r\n");
+        vm_pc = vm_recs[vm_ip].pc;
+    } else {
+        /* Fallback path: decode every step through the code cache */
+        vm_rec_t rec;
+        while(runaway < VM_OP_LIMIT && VM_BUDGET_LEFT()) {
+            if(vm_pc >= vm_pc_limit) {
+                vm_running = false;
+                break;
+            }
+            runaway++;
+            vm_trace_push(vm_pc);
+            uint8_t len = vm_decode(vm_pc, &rec);
+#if VM_BENCH
+            uint32_t t0 = tick_now();
+            res = vm_op_table[rec.h](&rec);
+            vm_bench_ticks[rec.h] += tick_now() - t0;
+            vm_bench_hits[rec.h]++;
+#else
+            res = vm_op_table[rec.h](&rec);
+#endif
+            if(res == VM_JUMP) {
+                vm_pc = rec.t;
+            } else if(res >= VM_CALL) {
+                if(!vm_call_ret(res, vm_pc, vm_pc + len, rec.t, &vm_pc)) break;
+            } else {
+                vm_pc += len;
+                if(res == VM_YIELD) break;
             }
         }
     }
+    vm_frame_ops = runaway;
+    vm_frame_capped = (res != VM_YIELD && vm_running);
+    vm_stat_frames++;
+    vm_stat_ops += runaway;
+    if(runaway < vm_stat_min) vm_stat_min = runaway;
+    if(runaway > vm_stat_max) vm_stat_max = runaway;
+    if(vm_frame_capped) vm_stat_capped++;
+#if VM_BENCH
+    vm_bench_frame_ticks += tick_now() - frame_t0;
+    vm_bench_frame_ops += runaway;
+#endif
+    vm_dl_build();
 }
 
-/* --- Hardware Utilities --- */
-void sound_init() {
-    RCC->PB1PCENR |= RCC_TIM2EN;
-    RCC->PB2PCENR |= RCC_IOPDEN;
+/* --- VM State Reset --- */
+/* The VM as a cold start sees it: PC 0, empty return stack, vars, objects
+ * and map cleared */
+static void vm_reset_state() {
+    vm_ip = 0;
+    vm_pc = 0;
+    vm_call_sp = 0;
+    vm_fault = VM_FAULT_NONE;
+    for(int i = 0; i < 64; i++) vm_vars[i] = 0; 
+    for(int i = 0; i < 32; i++) { 
+        vm_sprites[i][0] = 0; 
+        vm_sprites[i][1] = 0; 
+        vm_sprites[i][2] = 0; 
+        vm_sprites[i][3] = 0; 
+    }
+    for(int i = 0; i < 64; i++) {
+        vm_rects[i][0] = 0;
+        vm_rects[i][1] = 0;
+        vm_rects[i][2] = 0;
+        vm_rects[i][3] = 0;
+    }
+    vm_rect_unindex_all();
+    for(int i = 0; i < 256; i++) vm_map[i] = 0;
+    vm_num_count = 0;
+}
 
-    GPIOD->CFGLR &= ~(0xF << 12);
-    GPIOD->CFGLR |= (0xB << 12); 
+#if VM_SNAP
+/* --- VM Snapshot --- */
+/* EXT in the app bar writes the state of the running app to SNAP_ADDR
+ * (7 page writes) and the next launch of that slot streams it back in one
+ * sequential read instead of starting the app at PC 0. The header carries a
+ * stamp of the cartridge (CRC of its title, size and decoded records) and a
+ * CRC of the body, so a snapshot of a changed cartridge or a torn write falls
+ * back to a cold start. A snapshot is used once; S and link uploads drop it. */
+static const struct {
+    void *p;
+    uint16_t n;
+} vm_snap_parts[] = {
+    { &vm_pc, sizeof(vm_pc) },
+    { &vm_ip, sizeof(vm_ip) },
+    { &vm_call_sp, sizeof(vm_call_sp) },
+    { &vm_rng_seed, sizeof(vm_rng_seed) },
+    { &vm_num_count, sizeof(vm_num_count) },
+    { vm_call_stack, sizeof(vm_call_stack) },
+    { vm_numbers, sizeof(vm_numbers) },
+    { vm_vars, sizeof(vm_vars) },
+    { vm_sprites, sizeof(vm_sprites) },
+    { vm_rects, sizeof(vm_rects) },
+    { vm_map, sizeof(vm_map) },
+};   // 775 bytes, with the header 0x0480..0x078D
+#define SNAP_PARTS (sizeof(vm_snap_parts) / sizeof(vm_snap_parts[0]))
 
-    TIM2->PSC = 48 - 1; 
-    TIM2->ATRLR = 1000; 
-    TIM2->CHCTLR1 |= (0x6 << 12); 
-    TIM2->CCER |= (1 << 4);       
-    TIM2->CH2CVR = 0;             
-    TIM2->CTLR1 |= TIM_CEN;
+/* Changes when the slot gets other code: title, ID, size and the records
+ * pre-decode made of it (per-step carts only have the first three) */
+static uint16_t vm_snap_stamp(uint8_t slot) {
+    uint8_t id[17];
+    eeprom_read_block(DEV_MEM_START + (slot * DEV_MEM_SIZE) + DEV_LBL_OFS, id, 17);
+    uint16_t crc = 0xFFFF;
+    for(uint8_t i = 0; i < 17; i++) crc = link_crc(crc, id[i]);
+    crc = link_crc(crc, vm_blocks);
+    crc = link_crc(crc, vm_packed);
+    const uint8_t *r = (const uint8_t *)vm_recs;
+    for(uint16_t i = 0; i < vm_rec_count * sizeof(vm_rec_t); i++) crc = link_crc(crc, r[i]);
+    return crc;
 }
 
-void beep_start(uint16_t freq, uint16_t duration) {
-    if (freq == 0) return;
-    TIM2->ATRLR = 1000000 / freq;
-    TIM2->CH2CVR = TIM2->ATRLR / 2; 
-    sound_timer = duration;
+void vm_snap_drop() {
+    if(vm_snap_slot == 0xFF) return;
+    eeprom_write_byte(SNAP_ADDR, 0xFF);
+    vm_snap_slot = 0xFF;
+}
+
+/* Boot: which slot has a snapshot (the launcher marks it) */
+void vm_snap_probe() {
+    uint8_t hdr[3];
+    eeprom_read_block(SNAP_ADDR, hdr, 3);
+    vm_snap_slot = (hdr[0] == SNAP_MAGIC && hdr[1] == SNAP_VER && hdr[2] <= 30) ? hdr[2] : 0xFF;
+}
+
+/* Called between frames with the app stopped. The parts go straight from
+ * the VM arrays into page writes, so nothing is staged and the decoded
+ * records stay valid. */
+void vm_snap_save() {
+    FT_NEST(FT_EEPROM);
+    uint32_t t0 = tick_now();
+    uint16_t stamp = vm_snap_stamp(vm_slot);
+    uint16_t crc = 0xFFFF;
+    for(uint8_t k = 0; k < SNAP_PARTS; k++) {
+        const uint8_t *p = vm_snap_parts[k].p;
+        for(uint16_t i = 0; i < vm_snap_parts[k].n; i++) crc = link_crc(crc, p[i]);
+    }
+    uint8_t hdr[SNAP_HDR] = { SNAP_MAGIC, SNAP_VER, vm_slot, stamp >> 8, stamp & 0xFF, crc >> 8, crc & 0xFF };
+    eeprom_put_begin(SNAP_ADDR);
+    for(uint8_t i = 0; i < SNAP_HDR; i++) eeprom_put(hdr[i]);
+    for(uint8_t k = 0; k < SNAP_PARTS; k++) {
+        const uint8_t *p = vm_snap_parts[k].p;
+        for(uint16_t i = 0; i < vm_snap_parts[k].n; i++) eeprom_put(p[i]);
+    }
+    eeprom_put_end();
+    vm_snap_slot = vm_slot;
+    snap_save_ticks = tick_now() - t0;
+    FT_LEAVE();
+}
+
+/* Called by vm_launch() after pre-decode and vm_reset_state(). On any
+ * mismatch the state is reset again and the app starts cold. */
+static bool vm_snap_resume(uint8_t slot) {
+    FT_NEST(FT_EEPROM);
+    uint16_t stamp = vm_snap_stamp(slot);
+    uint8_t seed = vm_rng_seed;
+    uint8_t hdr[SNAP_HDR];
+    eeprom_stream_begin(SNAP_ADDR);
+    for(uint8_t i = 0; i < SNAP_HDR; i++) hdr[i] = eeprom_stream_next();
+    bool ok = (hdr[0] == SNAP_MAGIC && hdr[1] == SNAP_VER && hdr[2] == slot &&
+               ((hdr[3] << 8) | hdr[4]) == stamp);
+    if(ok) {
+        uint16_t crc = 0xFFFF;
+        for(uint8_t k = 0; k < SNAP_PARTS; k++) {
+            uint8_t *p = vm_snap_parts[k].p;
+            for(uint16_t i = 0; i < vm_snap_parts[k].n; i++) {
+                p[i] = eeprom_stream_next();
+                crc = link_crc(crc, p[i]);
+            }
+        }
+        ok = (crc == ((hdr[5] << 8) | hdr[6]) && vm_call_sp <= VM_CALL_DEPTH && vm_num_count <= 8 &&
+              (vm_rec_count == 0 || vm_ip < vm_rec_count));
+    }
+    eeprom_stream_end();
+    vm_snap_drop();
+    if(ok) {
+        for(uint8_t i = 0; i < 64; i++) vm_rect_mark(i, true);
+    } else {
+        vm_reset_state();
+        vm_rng_seed = seed;
+    }
+    FT_LEAVE();
+    return ok;
 }
+#endif
 
-void sound_update() {
-    if (sound_timer > 0) {
-        sound_timer--;
+/* --- VM App Launch --- */
+/* Sizes the cartridge (its slot plus following DEV_ID_CONT slots, or the
+ * block count of a packed slot), empties the code cache, pre-decodes the
+ * app when its records fit and resets the VM. Pre-decode reads the code
+ * blocks as one stream; everything else is paged in on first use. A
+ * DEV_ID_CONT slot is not an app of its own and does not start. With
+ * VM_SNAP the app continues from its snapshot when there is one. */
+void vm_launch(uint8_t slot) {
+    uint16_t base = DEV_MEM_START + (slot * DEV_MEM_SIZE);
+    vm_slot = slot;
+    uint32_t t0 = tick_now();
+    snd_stop();
+    uint32_t bytes0 = eeprom_rd_bytes;
+    bool cont = (eeprom_read_byte(base + DEV_ID_OFS) == DEV_ID_CONT);
+    uint8_t hdr[DEV_PACK_HDR];
+    eeprom_read_block(base + DEV_CMD_OFS, hdr, DEV_PACK_HDR);
+    vm_packed = (hdr[0] == DEV_PACK_MAGIC && hdr[1] == DEV_PACK_VER &&
+                 hdr[2] > 0 && hdr[2] <= VM_BLOCKS * VM_SPAN_MAX);
+    if(vm_packed) {
+        vm_blocks = hdr[2];   // All in this slot, DEV_ID_CONT slots are not used
     } else {
-        TIM2->CH2CVR = 0;
+        uint8_t span = 1;
+        while(span < VM_SPAN_MAX && slot + span <= 30 &&
+              eeprom_read_byte(base + span * DEV_MEM_SIZE + DEV_ID_OFS) == DEV_ID_CONT) span++;
+        vm_blocks = span * VM_BLOCKS;
+    }
+    vm_pc_limit = vm_blocks * VM_PAGE - 6;
+    vm_cache_flush();
+    vm_predecode();
+    cart_load_ticks = tick_now() - t0;
+    cart_load_bytes = eeprom_rd_bytes - bytes0;
+    vm_cache_reset_stats();
+#if IN_REC
+    in_start();
+#endif
+    vm_running = !cont; 
+#if VM_BENCH
+    vm_bench_reset();
+#endif
+#if VM_PROF
+    vm_prof_reset();
+#endif
+    vm_stat_frames = 0;
+    vm_stat_ops = 0;
+    vm_stat_min = 0xFFFF;
+    vm_stat_max = 0;
+    vm_stat_capped = 0;
+    oled_stat_frames = 0;
+    oled_stat_pages = 0;
+    oled_stat_ticks = 0;
+#if OLED_HW_I2C
+    oled_stat_wait = 0;
+#endif
+    vm_trace_idx = 0;
+    for(int i = 0; i < 16; i++) vm_trace[i] = 0;
+    vm_reset_state();
+#if VM_SNAP
+    vm_resumed = false;
+    if(vm_snap_slot == slot && vm_running) {
+        uint32_t t1 = tick_now();
+        uint32_t bytes1 = eeprom_rd_bytes;
+        vm_resumed = vm_snap_resume(slot);
+        cart_load_ticks += tick_now() - t1;
+        cart_load_bytes += eeprom_rd_bytes - bytes1;
     }
+    if(vm_resumed) cart_resume_ticks = cart_load_ticks;
+    else cart_cold_ticks = cart_load_ticks;
+#endif
+    vm_dl_build();
 }
 
-uint16_t adc_read(uint8_t ch) {
-    ADC1->RSQR3 = ch; 
-    ADC1->CTLR2 |= ADC_SWSTART; 
-    while(!(ADC1->STATR & ADC_EOC));
-    uint16_t dummy = ADC1->RDATAR; 
-    (void)dummy; 
-    ADC1->RSQR3 = ch; 
-    ADC1->CTLR2 |= ADC_SWSTART; 
-    while(!(ADC1->STATR & ADC_EOC));
-    return (uint16_t)ADC1->RDATAR;
+/* --- VM Renderer (current_page) --- */
+/* Draws the tilemap row and the display list entries of current_page. All
+ * drawing ORs into the page, so bucketing does not change the result. Tile
+ * and bitmap blocks come from the code cache; block numbers past the
+ * cartridge draw nothing. */
+void render_vm_page() {
+    uint8_t p = current_page;
+    for(int i = p << 4; i < (p << 4) + 16; i++) {
+        uint8_t tile = vm_map[i];
+        if(tile > 0 && tile < vm_blocks) {
+            blit_columns((i & 0x0F) << 3, p << 3, vm_cache_page(tile) + 9, 8, 0xFF);
+        }
+    }
+    for(uint32_t m = vm_dl_sprites[p]; m; m &= m - 1) {
+        uint8_t i = __builtin_ctz(m);
+        if(vm_sprites[i][2] == 1) {
+            draw_char(vm_sprites[i][0], vm_sprites[i][1], vm_sprites[i][3]);
+        } else {
+            blit_columns(vm_sprites[i][0], vm_sprites[i][1], vm_cache_page(vm_sprites[i][3]) + 9, 8, 0xFF);
+        }
+    }
+    for(uint64_t m = vm_dl_rects[p]; m; m &= m - 1) {
+        uint8_t i = __builtin_ctzll(m);
+        draw_window(vm_rects[i][0], vm_rects[i][1], vm_rects[i][2], vm_rects[i][3]);
+    }
+    for(uint8_t m = vm_dl_numbers[p]; m; m &= m - 1) {
+        uint8_t i = __builtin_ctz(m);
+        draw_number(vm_numbers[i][1], vm_numbers[i][2], vm_numbers[i][0]);
+    }
 }
 
 /* --- Hardware Setup --- */
+void font_load() {
+    eeprom_read_block(0x0100, font_cache[0], 95 * 5);     // ASCII 32..126
+    eeprom_read_block(0x02DB, font_cache[95], 63 * 5);    // Kana 0xA1..0xDF
+
+    for(int j = 0; j < 5; j++) {
+        font_cache[0][j] = 0x00;
+    }
+}
+
+/* Titles of the 4 launcher rows from top; only the rows on screen are kept */
+void slot_titles_load(uint8_t top) {
+    for(int s = 0; s < 4; s++) {
+        uint8_t slot = top + s;
+        for(int j = 0; j < 16; j++) slot_titles[s][j] = ' ';
+        slot_titles[s][16] = '\0';
+        if(slot > 30) continue;
+        uint8_t hdr[17];   // Label (0x00..0x0F) + ID (0x10) in one burst
+        eeprom_read_block(DEV_MEM_START + (slot * DEV_MEM_SIZE) + DEV_LBL_OFS, hdr, 17);
+        if(hdr[DEV_ID_OFS] != 0xFF) {
+            for (int i = 0; i < 16; i++) {
+                char c = (char)hdr[i];
+                slot_titles[s][i] = ((c >= 32 && c <= 126) || (c >= 0xA1 && c <= 0xDF)) ? c : ' ';
+            }
+        }
+    }
+    slot_titles_top = top;
+}
+
 void setup() {
     SystemInit();
     Delay_Init();
@@ -585,23 +3685,22 @@ void setup() {
     GPIOA->BSHR = (1 << 0) | (1 << 3) | (1 << 4) | (1 << 5) | (1 << 6) | (1 << 7);
 
     USART1->BRR = 0x1A1; 
-    USART1->CTLR1 = 0x200C;
+    USART1->CTLR1 = 0x202C;   // UE | RXNEIE | TE | RE
+    NVIC_EnableIRQ(USART1_IRQn);
 
     ADC1->CTLR2 |= (1 << 20) | (7 << 17) | ADC_ADON; 
     Delay_Ms(5);
+    tick_init();   // Free-runs from here on; Delay_Ms() would stop it again
     oled_init();
+#if OLED_HW_I2C
+    i2c_hw_init();
+#endif
     sound_init();
     
     adc_offset_x = adc_read(1); 
     adc_offset_y = adc_read(0);
     
-    soft_i2c_start(); 
-    soft_i2c_write((EEPROM_ADDR << 1) | 0); 
-    soft_i2c_write(0); 
-    soft_i2c_write(0); 
-    soft_i2c_write(0xAA); 
-    soft_i2c_stop(); 
-    Delay_Ms(5);
+    eeprom_write_byte(0, 0xAA);   // The read below ACK-polls for the write cycle
     
     if(eeprom_read_byte(0) == 0xAA) { 
         eeprom_ok = true; 
@@ -611,39 +3710,15 @@ void setup() {
         if(e_maj != 0xFF) app_ver_major = e_maj;
         if(e_min != 0xFF) app_ver_minor = e_min;
 
-        for(int i = 0; i < 95; i++) { 
-            uint16_t addr = 0x0100 + i * 5; 
-            for(int j = 0; j < 5; j++) {
-                font_cache[i][j] = eeprom_read_byte(addr + j); 
-            }
-        } 
-        for(int i = 0; i < 63; i++) { 
-            uint16_t addr = 0x02DB + i * 5; 
-            for(int j = 0; j < 5; j++) {
-                font_cache[95 + i][j] = eeprom_read_byte(addr + j); 
-            }
-        } 
-
-        for(int j = 0; j < 5; j++) {
-            font_cache[0][j] = 0x00;
-        }
-        
-        for(int i = 0; i < 31; i++) {
-            for(int j = 0; j < 16; j++) slot_titles[i][j] = ' ';
-            slot_titles[i][16] = '\0';
-        }
-
-        for (int slot = 0; slot < 31; slot++) {
-            uint16_t base_addr = DEV_MEM_START + (slot * DEV_MEM_SIZE);
-            uint8_t id = eeprom_read_byte(base_addr + DEV_ID_OFS);
-            if(id != 0xFF) {
-                for (int i = 0; i < 16; i++) {
-                    char c = (char)eeprom_read_byte(base_addr + DEV_LBL_OFS + i);
-                    slot_titles[slot][i] = ((c >= 32 && c <= 126) || (c >= 0xA1 && c <= 0xDF)) ? c : ' ';
-                }
-            }
-        }
+        uint32_t t0 = tick_now();
+        font_load();
+        slot_titles_load(0);
+        boot_load_ticks = tick_now() - t0;
+#if VM_SNAP
+        vm_snap_probe();
+#endif
     }
+    FT_DISCARD();
 }
 
 /* --- Main Loop --- */
@@ -652,9 +3727,12 @@ int main(void) {
     static bool pc_link_mode = false;
     bool req_pc_link = false;
     static bool last_sw = true;
+#if VM_SCHED_TIME
+    uint32_t frame_t0 = 0;
+#endif
     
     while(1) {
-        sound_update();
+        FT_ENTER(FT_INPUT);
         bool cur_sw = (GPIOC->INDR & (1 << 4));
         bool clicked = (last_sw && !cur_sw);
         last_sw = cur_sw;
@@ -662,18 +3740,19 @@ int main(void) {
         if (req_pc_link) {
             pc_link_mode = true;
             req_pc_link = false;
+            if(vm_running) {   // Uploads may rewrite the slot the code cache pages from
+                vm_running = false;
+                snd_stop();
+            }
+            vm_cache_flush();
             show_dashboard();
+            oled_frame_begin();
             for (current_page = 0; current_page < 8; current_page++) {
                 for(int i = 0; i < 128; i++) oled_buffer[i] = 0;
                 draw_window(0, 0, 128, 64); 
                 draw_string(43, 24, "PC LINK"); 
                 draw_string(40, 40, "SW: EXIT");
-                oled_set_pos(0, current_page); 
-                soft_i2c_start(); 
-                soft_i2c_write(OLED_ADDR); 
-                soft_i2c_write(0x40); 
-                for(int x = 0; x < 128; x++) soft_i2c_write(oled_buffer[x]); 
-                soft_i2c_stop();
+                oled_send_page();
             }
             continue;
         }
@@ -685,9 +3764,25 @@ int main(void) {
             } else {
                 check_serial(&pc_link_mode); 
             }
+            FT_DISCARD();
             continue; 
         }
 
+        FT_ENTER(FT_SERIAL);
+        check_serial(&pc_link_mode);   // Read-only commands stay live while apps run
+
+        /* --- Frame Pacing (VM_FRAME_HZ) --- */
+        FT_ENTER(FT_IDLE);
+#if VM_SCHED_TIME
+        while((tick_now() - frame_t0) < VM_FRAME_TICKS);
+        if((tick_now() - frame_t0) < 2 * VM_FRAME_TICKS) {
+            frame_t0 += VM_FRAME_TICKS;
+        } else {
+            frame_t0 = tick_now();
+        }
+#endif
+        FT_FRAME();
+
         uint16_t x_raw = adc_read(1);
         uint16_t y_raw = adc_read(0); 
         
@@ -701,9 +3796,16 @@ int main(void) {
         
         if(diff_y > DEADZONE) dy = diff_y / 128; 
         else if(diff_y < -DEADZONE) dy = diff_y / 128;
+
+        uint8_t btn = 0;   // BUTTON (0x05) bits, sampled once per frame
+        if(!(GPIOD->INDR & (1 << 0))) btn |= 1; 
+        if(!(GPIOC->INDR & (1 << 3))) btn |= 2; 
+        if(!cur_sw) btn |= 4;
+#if IN_REC
+        if(menu_state == 3 && vm_running) in_frame(&dx, &dy, &btn);
+#endif
         
-        mouse_x = (uint8_t)constrain(mouse_x + dx, 0, 127); 
-        mouse_y = (uint8_t)constrain(mouse_y + dy, 0, 63);
+        cursor_move(dx, dy);
 
         int16_t abs_dy = diff_y;
         if(abs_dy < 0) abs_dy = -abs_dy;
@@ -714,190 +3816,19 @@ int main(void) {
 
         /* --- VM Engine Execution (1 Frame Pass) --- */
         if (menu_state == 3 && vm_running) {
-            vm_num_count = 0;
-            int runaway = 0;
-            while(runaway++ < 100) {
-                if(vm_pc >= (DEV_MEM_SIZE - DEV_CMD_OFS - 6)) {
-                    vm_running = false;
-                    break;
-                }
-
-                vm_trace[vm_trace_idx] = DEV_CMD_OFS + vm_pc;
-                vm_trace_idx = (vm_trace_idx + 1) & 0x0F;
-                last_vm_pc = DEV_CMD_OFS + vm_pc;
-
-                uint8_t op = vm_memory[DEV_CMD_OFS + vm_pc];
-                uint8_t p1 = vm_memory[DEV_CMD_OFS + vm_pc + 1];
-                uint8_t p2 = vm_memory[DEV_CMD_OFS + vm_pc + 2];
-                uint8_t p3 = vm_memory[DEV_CMD_OFS + vm_pc + 3];
-                uint8_t p4 = vm_memory[DEV_CMD_OFS + vm_pc + 4];
-
-                if(op == 0x00) { 
-                    vm_pc++; 
-                } 
-                else if(op == 0x01) { 
-                    vm_vars[p1 & 0x3F] = p2; 
-                    vm_pc += 3; 
-                } 
-                else if(op == 0x02) { 
-                    vm_vars[p1 & 0x3F] += p2; 
-                    vm_pc += 3; 
-                } 
-                else if(op == 0x0A) { 
-                    vm_vars[p1 & 0x3F] -= p2; 
-                    vm_pc += 3; 
-                } 
-                else if(op == 0x0B) { 
-                    vm_vars[p1 & 0x3F] = mouse_x;
-                    vm_vars[p2 & 0x3F] = mouse_y;
-                    vm_pc += 3;
-                }
-                else if(op == 0x03) { 
-                    uint8_t idx = p1 & 0x1F;
-                    vm_sprites[idx][0] = vm_vars[p2 & 0x3F];
-                    vm_sprites[idx][1] = vm_vars[p3 & 0x3F];
-                    vm_sprites[idx][2] = 1;
-                    vm_sprites[idx][3] = p4;
-                    vm_pc += 5;
-                }
-                else if(op == 0x04) { 
-                    vm_vars[p1 & 0x3F] = (dx > 0) ? 1 : ((dx < 0) ? 255 : 0);
-                    vm_vars[p2 & 0x3F] = (dy > 0) ? 1 : ((dy < 0) ? 255 : 0);
-                    vm_pc += 3;
-                }
-                else if(op == 0x05) { 
-                    uint8_t b = 0;
-                    if(!(GPIOD->INDR & (1 << 0))) b |= 1; 
-                    if(!(GPIOC->INDR & (1 << 3))) b |= 2; 
-                    if(!cur_sw) b |= 4;                   
-                    vm_vars[p1 & 0x3F] = b;
-                    vm_pc += 2;
-                }
-                else if(op == 0x06) { 
-                    vm_pc = (p1 << 8) | p2;
-                }
-                else if(op == 0x07) { 
-                    if(vm_vars[p1 & 0x3F] == p2) vm_pc = (p3 << 8) | p4;
-                    else vm_pc += 5;
-                }
-                else if(op == 0x0C) { 
-                    if(vm_vars[p1 & 0x3F] > p2) vm_pc = (p3 << 8) | p4;
-                    else vm_pc += 5;
-                }
-                else if(op == 0x0D) { 
-                    if(vm_vars[p1 & 0x3F] < p2) vm_pc = (p3 << 8) | p4;
-                    else vm_pc += 5;
-                }
-                else if(op == 0x0E) { 
-                    if(vm_vars[p1 & 0x3F] != p2) vm_pc = (p3 << 8) | p4;
-                    else vm_pc += 5;
-                }
-                else if(op == 0x0F) { 
-                    static uint8_t seed = 0x55;
-                    seed ^= (seed << 3); seed ^= (seed >> 5); seed ^= (seed << 4);
-                    vm_vars[p1 & 0x3F] = (p2 > 0) ? (seed % p2) : 0;
-                    vm_pc += 3;
-                }
-                else if(op == 0x10) { 
-                    vm_vars[p1 & 0x3F] *= p2;
-                    vm_pc += 3;
-                }
-                else if(op == 0x11) { 
-                    if(p2 != 0) vm_vars[p1 & 0x3F] /= p2;
-                    vm_pc += 3;
-                }
-                else if(op == 0x12) { 
-                    if(p2 != 0) vm_vars[p1 & 0x3F] %= p2;
-                    vm_pc += 3;
-                }
-                else if(op == 0x13) { 
-                    vm_vars[p1 & 0x3F] = constrain(vm_vars[p1 & 0x3F], p2, p3);
-                    vm_pc += 4;
-                }
-                else if(op == 0x14) { 
-                    for(int i = 0; i < 32; i++) vm_sprites[i][2] = 0;
-                    for(int i = 0; i < 64; i++) vm_rects[i][2] = 0;
-                    for(int i = 0; i < 256; i++) vm_map[i] = 0;
-                    vm_pc += 1;
-                }
-                else if(op == 0x15) { 
-                    uint8_t idx = p1 & 0x3F;
-                    vm_rects[idx][0] = vm_vars[p2 & 0x3F];
-                    vm_rects[idx][1] = vm_vars[p3 & 0x3F];
-                    vm_rects[idx][2] = 1;
-                    vm_rects[idx][3] = 1;
-                    vm_pc += 4;
-                }
-                else if(op == 0x17) { 
-                    uint8_t idx = p1 & 0x3F;
-                    vm_rects[idx][0] = vm_vars[p2 & 0x3F];
-                    vm_rects[idx][1] = vm_vars[p3 & 0x3F];
-                    vm_rects[idx][2] = p4;
-                    vm_rects[idx][3] = vm_memory[DEV_CMD_OFS + vm_pc + 5];
-                    vm_pc += 6;
-                }
-                else if(op == 0x1A) {
-                    uint8_t vx = vm_vars[p1 & 0x3F];
-                    uint8_t vy = vm_vars[p2 & 0x3F];
-                    uint8_t r_idx = p3 & 0x3F;
-                    uint8_t rx = vm_rects[r_idx][0];
-                    uint8_t ry = vm_rects[r_idx][1];
-                    uint8_t rw = vm_rects[r_idx][2];
-                    uint8_t rh = vm_rects[r_idx][3];
-                    if (rw > 0 && (vx + 2) >= rx && vx < rx + rw && (vy + 2) >= ry && vy < ry + rh) {
-                        vm_pc = (p4 << 8) | vm_memory[DEV_CMD_OFS + vm_pc + 5];
-                    } else {
-                        vm_pc += 6;
-                    }
-                }
-                else if(op == 0x18) { 
-                    uint16_t freq = (p1 << 8) | p2;
-                    if(freq < 100) freq = 400;
-                    beep_start(freq, p3); 
-                    vm_pc += 4; 
-                }
-                else if(op == 0x19) { 
-                    uint8_t idx = p1 & 0x1F;
-                    vm_sprites[idx][0] = vm_vars[p2 & 0x3F];
-                    vm_sprites[idx][1] = vm_vars[p3 & 0x3F];
-                    vm_sprites[idx][2] = 2; 
-                    vm_sprites[idx][3] = p4; 
-                    vm_pc += 5;
-                }
-                else if(op == 0x1B) { 
-                    uint8_t val = vm_vars[p1 & 0x3F];
-                    if (vm_num_count < 8) {
-                        vm_numbers[vm_num_count][0] = val;
-                        vm_numbers[vm_num_count][1] = p2;
-                        vm_numbers[vm_num_count][2] = p3;
-                        vm_num_count++;
-                    }
-                    vm_pc += 5; 
-                }
-                else if(op == 0x1C) {
-                    uint8_t map_idx = vm_vars[p1 & 0x3F];
-                    vm_map[map_idx] = vm_vars[p2 & 0x3F];
-                    vm_pc += 3;
-                }
-                else if(op == 0x1D) {
-                    uint8_t map_idx = vm_vars[p1 & 0x3F];
-                    vm_vars[p2 & 0x3F] = vm_map[map_idx];
-                    vm_pc += 3;
-                }
-                else if(op == 0x08) { 
-                    beep_start(2000, 10); 
-                    vm_pc += 1; 
-                } 
-                else if(op == 0x09) { 
-                    vm_pc += 1; 
-                    break; 
-                }  
-                else { 
-                    vm_pc++; 
-                } 
-            }
+            vm_in_dx = dx;
+            vm_in_dy = dy;
+            vm_in_btn = btn;
+            FT_ENTER(FT_VM);
+            vm_run_frame();
         }
 
+        FT_ENTER(FT_RENDER);
+        uint32_t disp_t0 = tick_now();
+#if VM_SNAP
+        bool snap_req = false;   // EXT on a live app: snapshot once the frame is out
+#endif
+        oled_frame_begin();
         for (current_page = 0; current_page < 8; current_page++) {
             for(int i = 0; i < 128; i++) oled_buffer[i] = 0;
             
@@ -957,66 +3888,38 @@ int main(void) {
                 if (!vm_running) {
                     menu_state = 2;
                 } else {
-                    for(int i = 0; i < 128; i++) {
-                        uint8_t tile = vm_map[i];
-                        if(tile > 0) {
-                            uint8_t tx = (i & 0x0F) << 3; 
-                            uint8_t ty = (i >> 4) << 3;
-                            uint16_t addr = DEV_CMD_OFS + (tile * 32) + 9;
-                            uint8_t p_min = current_page << 3; 
-                            if(ty <= p_min + 7 && ty + 7 >= p_min) {
-                                for(uint8_t bx = 0; bx < 8; bx++) {
-                                    uint8_t line = vm_memory[addr + bx]; 
-                                    for(uint8_t by = 0; by < 8; by++) {
-                                        if(line & (1 << by)) {
-                                            draw_pixel(tx + bx, ty + by);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    for(int i = 0; i < 32; i++) {
-                        if(vm_sprites[i][2] == 1) {
-                            draw_char(vm_sprites[i][0], vm_sprites[i][1], vm_sprites[i][3]);
-                        } else if(vm_sprites[i][2] == 2) {
-                            uint8_t x = vm_sprites[i][0];
-                            uint8_t y = vm_sprites[i][1];
-                            uint16_t addr = DEV_CMD_OFS + (vm_sprites[i][3] * 32) + 9;
-                            uint8_t p_min = current_page << 3; 
-                            if(y <= p_min + 7 && y + 7 >= p_min) {
-                                for(uint8_t bx = 0; bx < 8; bx++) {
-                                    uint8_t line = vm_memory[addr + bx]; 
-                                    for(uint8_t by = 0; by < 8; by++) {
-                                        if(line & (1 << by)) {
-                                            draw_pixel(x + bx, y + by);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    for(int i = 0; i < 64; i++) {
-                        if(vm_rects[i][2] > 0) {
-                            draw_window(vm_rects[i][0], vm_rects[i][1], vm_rects[i][2], vm_rects[i][3]);
-                        }
-                    }
-                    for(int i = 0; i < vm_num_count; i++) {
-                        draw_number(vm_numbers[i][1], vm_numbers[i][2], vm_numbers[i][0]);
-                    }
+                    render_vm_page();
                 }
                 
                 if (mouse_y <= 5) {
                     draw_string(12, 3, "EXT");
+#if VM_SNAP
+                    draw_string(45, 3, "END");
+#endif
                     invert_rect(0, 0, 128, 12);
                     if (mouse_x < 40) { 
                         invert_rect(11, 2, 21, 9); 
                         if (clicked) { 
+#if VM_SNAP
+                            snap_req = vm_running && vm_fault == VM_FAULT_NONE;   // Saved after the page loop
+#endif
+                            menu_state = 0; 
+                            vm_running = false; 
+                            snd_stop();
+                            clicked = false; 
+                        } 
+                    }
+#if VM_SNAP
+                    else if (mouse_x < 80) { 
+                        invert_rect(44, 2, 21, 9); 
+                        if (clicked) {   // Quit without a snapshot
                             menu_state = 0; 
                             vm_running = false; 
+                            snd_stop();
                             clicked = false; 
                         } 
                     }
+#endif
                 }
             }
             else if (menu_state == 5) {
@@ -1124,41 +4027,14 @@ int main(void) {
                 }
                 
                 if (do_launch) {
-                    uint16_t base = DEV_MEM_START + (selected_slot * DEV_MEM_SIZE);
-                    for(uint16_t i = 0; i < DEV_MEM_SIZE; i++) {
-                        vm_memory[i] = eeprom_read_byte(base + i);
-                    }
-                    for(int b = 0; b <= 58; b++) {
-                        uint16_t block_base = DEV_CMD_OFS + (b * 32);
-                        uint8_t count = vm_memory[block_base + 8];
-                        if(count > 22) count = 22;
-                        for(int j = 9 + count; j < 32; j++) vm_memory[block_base + j] = 0x20;
-                    }
-                    vm_running = true; 
-                    vm_pc = 0;
-                    vm_trace_idx = 0;
-                    for(int i = 0; i < 16; i++) vm_trace[i] = 0;
-                    for(int i = 0; i < 64; i++) vm_vars[i] = 0; 
-                    for(int i = 0; i < 32; i++) { 
-                        vm_sprites[i][0] = 0; 
-                        vm_sprites[i][1] = 0; 
-                        vm_sprites[i][2] = 0; 
-                        vm_sprites[i][3] = 0; 
-                    }
-                    for(int i = 0; i < 64; i++) {
-                        vm_rects[i][0] = 0;
-                        vm_rects[i][1] = 0;
-                        vm_rects[i][2] = 0;
-                        vm_rects[i][3] = 0;
-                    }
-                    for(int i = 0; i < 256; i++) vm_map[i] = 0;
-                    vm_num_count = 0;
+                    vm_launch(selected_slot);
                     menu_state = 3;
                 }
 
                 if (!eeprom_ok) {
                     draw_string(20, 32, "NO EEPROM!");
                 } else {
+                    if(slot_titles_top != list_top_index) slot_titles_load(list_top_index);
                     for(int s = 0; s < 4; s++) {
                         uint8_t slot_idx = list_top_index + s;
                         if(slot_idx <= 30) {
@@ -1166,8 +4042,12 @@ int main(void) {
                             draw_string(4, row_y, "S"); 
                             draw_char(10, row_y, (slot_idx / 10) + '0'); 
                             draw_char(16, row_y, (slot_idx % 10) + '0'); 
+#if VM_SNAP
+                            draw_string(22, row_y, (slot_idx == vm_snap_slot) ? "*" : ":");   // * = resumes
+#else
                             draw_string(22, row_y, ":");
-                            draw_string(28, row_y, slot_titles[slot_idx]);
+#endif
+                            draw_string(28, row_y, slot_titles[s]);
                             if(slot_idx == selected_slot) {
                                 invert_rect(2, row_y - 1, 124, 9);
                             }
@@ -1197,7 +4077,7 @@ int main(void) {
                         if(clicked){ menu_state = (menu_state == 5) ? 0 : 5; clicked = false; } 
                     } 
                 } else {
-                    if(clicked && menu_state != 0 && !(menu_state == 1 && mouse_x < 70 && mouse_y < 36)) {
+                    if(clicked && menu_state != 0 && !(menu_state == 1 && mouse_x < 70 && mouse_y < SYS_MENU_END)) {
                         menu_state = 0;
                         clicked = false;
                     }
@@ -1205,7 +4085,7 @@ int main(void) {
 
                 if(menu_state == 0) {
                     draw_string(28, 18, "32V006 GemOS"); 
-                    draw_string(40, 30, "Ver 0.70");
+                    draw_string(40, 30, "Ver 0.95");
                     draw_string(25, 44, "APP Ver ");
                     draw_char(73, 44, (app_ver_major / 10) + '0');
                     draw_char(79, 44, (app_ver_major % 10) + '0');
@@ -1215,9 +4095,12 @@ int main(void) {
                 }
                 else if(menu_state == 1) {
                     invert_rect(11, 2, 21, 9); 
-                    draw_window(11, 11, 60, 26); 
+                    draw_window(11, 11, 60, SYS_MENU_END - 10); 
                     draw_string(17, 14, "I/O TEST");
                     draw_string(17, 25, "PC LINK");
+#if FT_PROF
+                    draw_string(17, 36, ft_overlay ? "PERF OFF" : "PERF ON");
+#endif
                     if(mouse_x > 11 && mouse_x < 71) {
                         if(mouse_y > 11 && mouse_y <= 21) {
                             invert_rect(13, 13, 56, 10); 
@@ -1226,17 +4109,26 @@ int main(void) {
                             invert_rect(13, 24, 56, 10); 
                             if(clicked){ req_pc_link = true; clicked = false; menu_state = 0; }
                         }
+#if FT_PROF
+                        else if(mouse_y >= 36 && mouse_y < SYS_MENU_END) {
+                            invert_rect(13, 35, 56, 10); 
+                            if(clicked){ ft_overlay = !ft_overlay; clicked = false; menu_state = 0; }
+                        }
+#endif
                     }
                 }
             }
 
+#if FT_PROF
+            if(ft_overlay && current_page == 7) ft_overlay_draw();
+#endif
             draw_cursor(mouse_x, mouse_y); 
-            oled_set_pos(0, current_page); 
-            soft_i2c_start(); 
-            soft_i2c_write(OLED_ADDR); 
-            soft_i2c_write(0x40); 
-            for(int x = 0; x < 128; x++) soft_i2c_write(oled_buffer[x]); 
-            soft_i2c_stop();
+            oled_send_page();
         }
+        oled_stat_ticks += tick_now() - disp_t0;
+        oled_stat_frames++;
+#if VM_SNAP
+        if(snap_req) vm_snap_save();   // Next launch of the slot resumes here
+#endif
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,998 @@
+# *********************************************************************************
+# Project Name : GemOS Cartridge Compiler
+# Version      : 1.03
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Compiles a small structured language (variables, if/while/loop, labels,
+# subroutines, sprite/rect/map calls) into the CODE.TXT format that
+# pc_link.py and pc_upload.py send. Code is packed into 22-byte command
+# blocks with a JMP to the next block instead of running through the block
+# headers, run through a peephole pass, and checked by a worst-case path
+# analysis that reports the most VM instructions any frame can take between
+# two FRAME (0x09) yields and per loop.
+#
+# Usage:
+#   python gemc.py [-o CODE.TXT] [-O0] [-l] [--cap 100] [--slots 1] APP.gem
+#
+# [Change History]
+# V1.03 - melody refuses a block past the cartridge's last block; the VM takes
+# the block operand whole, so carts of more slots reach blocks 64 and up.
+# V1.02 - emit of 0x84/0x85 (RAY_SCAN/RAY_FLIP) refuses steps with |dx| = 8, which
+# the VM decodes as dx -8 of the next row.
+# V1.01 - --slots N: code and data may use N x 59 blocks; PAYLOAD lines past
+# block 58 land in the following slots (GemOS V0.91 code cache).
+# V1.00 - Initial compiler: code generation, peephole pass, block layout and
+# per-frame instruction budget analysis.
+# *********************************************************************************
+
+import argparse
+import re
+import sys
+
+BLOCKS = 59          # Command blocks per slot (VM_BLOCKS)
+SPAN_MAX = 4         # Slots one cartridge may span (VM_SPAN_MAX)
+BLOCK_PAYLOAD = 22   # Payload bytes per block (count byte is always 0x22)
+HEADER_NOPS = 9      # Label + count bytes run as NOPs before block 0's code
+VM_OP_CAP = 100      # Legacy runaway cap (VM_SCHED_TIME 0, host runner)
+INF = float("inf")
+NEG = float("-inf")
+
+# OpCodes (GemOS_006_070.c vm_op_table)
+SET, ADD, SPRITE, JOY, BTN, JMP, JEQ, BEEP_S, FRAME, SUB, MOUSE = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B
+JGT, JLT, JNE, RAND, MUL, DIV, MOD, CLAMP, CLEAR, RECT = 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15
+RECT_SZ, BEEP, BITMAP, HIT, NUMBER, MAP_W, MAP_R, CALL, RET = 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F
+RAY_SCAN, RAY_FLIP = 0x84, 0x85
+MOV, ADDV, SUBV, JCMP, MELODY = 0x88, 0x89, 0x8A, 0x8D, 0x91
+JCMP_EQ, JCMP_NE, JCMP_LT, JCMP_GT = 0, 1, 2, 3
+
+# Instruction length per OpCode, as vm_decode() steps (unknown bytes are 1-byte NOPs)
+OP_LEN = {0x01: 3, 0x02: 3, 0x03: 5, 0x04: 3, 0x05: 2, 0x06: 3, 0x07: 5, 0x0A: 3,
+          0x0B: 3, 0x0C: 5, 0x0D: 5, 0x0E: 5, 0x0F: 3, 0x10: 3, 0x11: 3, 0x12: 3,
+          0x13: 4, 0x15: 4, 0x17: 6, 0x18: 4, 0x19: 5, 0x1A: 6, 0x1B: 5, 0x1C: 3,
+          0x1D: 3, 0x1E: 3, 0x80: 5, 0x81: 6, 0x82: 5, 0x83: 6, 0x84: 6, 0x85: 6,
+          0x86: 4, 0x87: 4, 0x88: 3, 0x89: 3, 0x8A: 3, 0x8B: 3, 0x8C: 3, 0x8D: 6,
+          0x8E: 3, 0x8F: 3, 0x90: 5, 0x91: 3}
+BRANCHES = {JMP, JEQ, JGT, JLT, JNE, HIT, CALL, JCMP}
+NO_FALL = {JMP, RET}
+SIMPLE = {"frame": FRAME, "clear": CLEAR, "return": RET}
+ARITH = {"+=": ADD, "-=": SUB, "*=": MUL, "/=": DIV, "%=": MOD}
+INVERT = {"==": "!=", "!=": "==", "<": ">=", ">=": "<", ">": "<=", "<=": ">"}
+
+TOKEN = re.compile(r'"[^"]*"|\'.\'|0[xX][0-9A-Fa-f]+|\w+|==|!=|<=|>=|\+=|-=|\*=|/=|%=|\S')
+
+
+def ray_dx(step):
+    """dx of a RAY_SCAN/RAY_FLIP step byte, split as vm_ray() does."""
+    s = step - 256 if step > 127 else step
+    return s - ((s + 8) >> 4) * 16
+
+
+class CompileError(Exception):
+    def __init__(self, line, msg):
+        super().__init__(msg)
+        self.line = line
+
+
+class Ins:
+    """One VM instruction, or a label when op is None."""
+
+    def __init__(self, op, args=(), target=None, line=0, tags=(), name=None):
+        self.op = op
+        self.args = list(args)
+        self.target = target   # Label jumped to (addr16 appended on encode)
+        self.line = line
+        self.tags = tags       # Enclosing loop ids, outermost first
+        self.name = name       # Label name
+        self.addr = 0
+
+    def length(self):
+        return 1 + len(self.args) + (2 if self.target is not None else 0)
+
+    def falls(self):
+        return self.op not in NO_FALL
+
+
+class Loop:
+    def __init__(self, lid, kind, line, bound, entry):
+        self.lid = lid
+        self.kind = kind
+        self.line = line
+        self.bound = bound
+        self.entry = entry     # Label of the first instruction of every iteration
+        self.nodes = []
+        self.yields = False
+        self.collapsed = False
+
+
+# --- Front End ---
+
+class Compiler:
+    def __init__(self, blocks=BLOCKS):
+        self.blocks = blocks   # Command blocks of the cartridge, data fills from the end
+        self.vars = {}
+        self.consts = {}
+        self.data = {}         # name -> (block, bytes)
+        self.subs = {}         # name -> line
+        self.labels = set()
+        self.title = None
+        self.appver = None
+        self.main = []
+        self.sub_code = []
+        self.code = self.main
+        self.loops = {}
+        self.loop_stack = []   # (lid, continue label, break label)
+        self.n_label = 0
+        self.line = 0
+
+    def err(self, msg):
+        raise CompileError(self.line, msg)
+
+    def new_label(self):
+        self.n_label += 1
+        return f"_L{self.n_label}"
+
+    def tags(self):
+        return tuple(l[0] for l in self.loop_stack)
+
+    def emit(self, op, args=(), target=None):
+        for a in args:
+            if not 0 <= a <= 255:
+                self.err(f"operand {a} out of range 0..255")
+        self.code.append(Ins(op, args, target, self.line, self.tags()))
+
+    def label(self, name):
+        self.code.append(Ins(None, line=self.line, tags=self.tags(), name=name))
+
+    # Operands
+    def number(self, tok):
+        if tok in self.consts:
+            return self.consts[tok]
+        if tok in self.data:
+            return self.data[tok][0]
+        if len(tok) == 3 and tok[0] == "'" and tok[2] == "'":
+            return ord(tok[1])
+        try:
+            return int(tok, 0)
+        except ValueError:
+            pass
+        try:
+            return int(tok, 10)       # Zero-padded decimal, e.g. slot 03
+        except ValueError:
+            self.err(f"'{tok}' is not a number or constant")
+
+    def var(self, tok):
+        if tok not in self.vars:
+            self.err(f"'{tok}' is not a variable")
+        return self.vars[tok]
+
+    def value(self, tok):
+        """('var', id) or ('imm', n)"""
+        if tok in self.vars:
+            return ("var", self.vars[tok])
+        return ("imm", self.number(tok))
+
+    # Conditions: jump to target when the condition equals truth, else fall through
+    def jump_if(self, cond, truth, target):
+        if cond and cond[0] == "!":
+            return self.jump_if(cond[1:], not truth, target)
+        if cond and cond[0] == "hit":
+            if len(cond) != 4:
+                self.err("hit needs: hit XVAR YVAR RECT")
+            args = [self.var(cond[1]), self.var(cond[2]), self.number(cond[3]) & 0x3F]
+            if truth:
+                self.emit(HIT, args, target)
+            else:
+                skip = self.new_label()
+                self.emit(HIT, args, skip)
+                self.emit(JMP, (), target)
+                self.label(skip)
+            return
+        if len(cond) == 1 and cond[0] in ("true", "false"):
+            if (cond[0] == "true") == truth:
+                self.emit(JMP, (), target)
+            return
+        if len(cond) != 3 or cond[1] not in INVERT:
+            self.err("condition must be: VAR OP VALUE, hit X Y RECT or true")
+        a = self.var(cond[0])
+        op = cond[1] if truth else INVERT[cond[1]]
+        kind, b = self.value(cond[2])
+        if kind == "imm":
+            if not 0 <= b <= 255:
+                self.err(f"operand {b} out of range 0..255")
+            if op == "==":
+                self.emit(JEQ, (a, b), target)
+            elif op == "!=":
+                self.emit(JNE, (a, b), target)
+            elif op == "<":
+                if b > 0:
+                    self.emit(JLT, (a, b), target)
+            elif op == ">":
+                if b < 255:
+                    self.emit(JGT, (a, b), target)
+            elif op == "<=":
+                self.emit(JLT, (a, b + 1), target) if b < 255 else self.emit(JMP, (), target)
+            else:
+                self.emit(JGT, (a, b - 1), target) if b > 0 else self.emit(JMP, (), target)
+        else:
+            conds = {"==": [JCMP_EQ], "!=": [JCMP_NE], "<": [JCMP_LT], ">": [JCMP_GT],
+                     "<=": [JCMP_LT, JCMP_EQ], ">=": [JCMP_GT, JCMP_EQ]}[op]
+            for c in conds:
+                self.emit(JCMP, (a, b, c), target)
+
+    # Statements
+    def statement(self, t, lines, i):
+        """Compiles the statement on tokens t; returns the next line index."""
+        head = t[0]
+        if len(t) == 2 and t[1] == ":":
+            name = "u_" + head
+            if name in self.labels:
+                self.err(f"label '{head}' defined twice")
+            self.labels.add(name)
+            self.label(name)
+        elif head in SIMPLE and len(t) == 1:
+            self.emit(SIMPLE[head])
+        elif head == "goto" and len(t) == 2:
+            self.emit(JMP, (), "u_" + t[1])
+        elif head == "call" and len(t) == 2:
+            self.emit(CALL, (), "s_" + t[1])
+        elif head == "beep":
+            if len(t) == 1:
+                self.emit(BEEP_S)
+            elif len(t) == 3:
+                f = self.number(t[1])
+                self.emit(BEEP, ((f >> 8) & 0xFF, f & 0xFF, self.number(t[2])))
+            else:
+                self.err("beep needs no operands or: beep FREQ LENGTH")
+        elif head == "melody" and len(t) == 3:
+            blk = self.number(t[1])
+            if blk >= self.blocks:
+                self.err(f"melody block {blk} out of range 0..{self.blocks - 1}")
+            self.emit(MELODY, (blk, self.number(t[2])))
+        elif head == "joy" and len(t) == 3:
+            self.emit(JOY, (self.var(t[1]), self.var(t[2])))
+        elif head == "mouse" and len(t) == 3:
+            self.emit(MOUSE, (self.var(t[1]), self.var(t[2])))
+        elif head == "buttons" and len(t) == 2:
+            self.emit(BTN, (self.var(t[1]),))
+        elif head == "clamp" and len(t) == 4:
+            self.emit(CLAMP, (self.var(t[1]), self.number(t[2]), self.number(t[3])))
+        elif head == "sprite" and len(t) == 5:
+            self.emit(SPRITE, (self.number(t[1]), self.var(t[2]), self.var(t[3]), self.number(t[4])))
+        elif head == "bitmap" and len(t) == 5:
+            self.emit(BITMAP, (self.number(t[1]), self.var(t[2]), self.var(t[3]), self.number(t[4])))
+        elif head == "rect" and len(t) == 4:
+            self.emit(RECT, (self.number(t[1]), self.var(t[2]), self.var(t[3])))
+        elif head == "rect" and len(t) == 6:
+            self.emit(RECT_SZ, (self.number(t[1]), self.var(t[2]), self.var(t[3]),
+                                self.number(t[4]), self.number(t[5])))
+        elif head == "number" and len(t) == 4:
+            self.emit(NUMBER, (self.var(t[1]), self.number(t[2]), self.number(t[3]), 0))
+        elif head == "emit":
+            raw = [self.number("0x" + x if not x.startswith(("0x", "0X")) else x) for x in t[1:]]
+            if not raw or OP_LEN.get(raw[0], 1) != len(raw) or raw[0] in BRANCHES or raw[0] in NO_FALL:
+                self.err("emit needs one complete non-branch instruction in hex")
+            if raw[0] in (RAY_SCAN, RAY_FLIP) and not -7 <= ray_dx(raw[3]) <= 7:
+                self.err("ray step needs dx + 16 * dy with |dx| <= 7")
+            self.emit(raw[0], raw[1:])
+        elif head == "map" and len(t) == 6 and t[1] == "[" and t[3] == "]" and t[4] == "=":
+            self.emit(MAP_W, (self.var(t[2]), self.var(t[5])))
+        elif len(t) >= 3 and t[1] == "=" and head in self.vars:
+            self.assign(t)
+        elif len(t) == 3 and t[1] in ARITH and head in self.vars:
+            a = self.var(head)
+            kind, b = self.value(t[2])
+            if kind == "var":
+                if t[1] not in ("+=", "-="):
+                    self.err(f"{t[1]} takes a number")
+                self.emit(ADDV if t[1] == "+=" else SUBV, (a, b))
+            else:
+                self.emit(ARITH[t[1]], (a, b & 0xFF))
+        elif head in ("break", "continue") and len(t) == 1:
+            if not self.loop_stack:
+                self.err(f"{head} outside a loop")
+            lid, cont, brk = self.loop_stack[-1]
+            self.emit(JMP, (), brk if head == "break" else cont)
+        elif head == "if":
+            return self.if_stmt(t, lines, i)
+        elif head in ("while", "loop"):
+            return self.loop_stmt(t, lines, i)
+        else:
+            self.err("unknown statement: " + " ".join(t))
+        return i + 1
+
+    def assign(self, t):
+        a = self.var(t[0])
+        rhs = t[2:]
+        if len(rhs) == 1:
+            kind, b = self.value(rhs[0])
+            if kind == "var":
+                self.emit(MOV, (a, b))
+            else:
+                self.emit(SET, (a, b & 0xFF))
+        elif len(rhs) == 2 and rhs[0] == "rand":
+            self.emit(RAND, (a, self.number(rhs[1])))
+        elif len(rhs) == 4 and rhs[0] == "map" and rhs[1] == "[" and rhs[3] == "]":
+            self.emit(MAP_R, (self.var(rhs[2]), a))
+        else:
+            self.err("assignment must be: VAR = VALUE, VAR = rand N or VAR = map[VAR]")
+
+    def block(self, lines, i):
+        """Statements up to the closing '}'; returns the index of that line."""
+        while i < len(lines):
+            self.line, t = lines[i]
+            if t[0] == "}":
+                return i
+            i = self.statement(t, lines, i)
+        self.err("missing '}'")
+
+    def opening(self, t, what):
+        if t[-1] != "{":
+            self.err(f"{what} must end with '{{'")
+        return t[:-1]
+
+    def if_stmt(self, t, lines, i):
+        end = self.new_label()
+        cond = self.opening(t[1:], "if")
+        while True:
+            nxt = self.new_label()
+            self.jump_if(cond, False, nxt)
+            i = self.block(lines, i + 1)
+            self.line, t = lines[i]
+            if len(t) == 1:
+                self.label(nxt)
+                break
+            self.emit(JMP, (), end)
+            self.label(nxt)
+            if t[1] == "elif":
+                cond = self.opening(t[2:], "elif")
+                continue
+            if t[1:] != ["else", "{"]:
+                self.err("expected '}', '} else {' or '} elif COND {'")
+            i = self.block(lines, i + 1)
+            break
+        self.label(end)
+        return i + 1
+
+    def loop_stmt(self, t, lines, i):
+        head = self.opening(t, t[0])
+        bound = None
+        if len(head) >= 3 and head[-2] == "max":
+            bound = self.number(head[-1])
+            head = head[:-2]
+        cond = head[1:]
+        if t[0] == "loop" and cond:
+            self.err("loop takes no condition (use while)")
+        lid = len(self.loops)
+        body, test, end = self.new_label(), self.new_label(), self.new_label()
+        entry = body if t[0] == "loop" else test
+        self.loops[lid] = Loop(lid, t[0], self.line, bound, entry)
+        if t[0] == "while":
+            self.emit(JMP, (), test)     # Rotated: the test sits below the body
+        self.loop_stack.append((lid, entry, end))
+        self.label(body)
+        i = self.block(lines, i + 1)
+        if t[0] == "while":
+            self.label(test)
+            self.jump_if(cond, True, body)
+        else:
+            self.emit(JMP, (), body)
+        self.loop_stack.pop()
+        self.label(end)
+        if lines[i][1] != ["}"]:
+            self.line = lines[i][0]
+            self.err("expected '}'")
+        return i + 1
+
+    # Top level
+    def compile(self, text):
+        lines = []
+        for n, raw in enumerate(text.splitlines(), 1):
+            raw = raw.split("#", 1)[0].strip()
+            if raw:
+                lines.append((n, TOKEN.findall(raw)))
+        i = 0
+        while i < len(lines):
+            self.line, t = lines[i]
+            head = t[0]
+            if head == "app" and len(t) == 4:
+                self.title = (self.number(t[1]), int(t[2], 16), t[3].strip('"'))
+            elif head == "appver" and len(t) == 3:
+                self.appver = (self.number(t[1]), self.number(t[2]))
+            elif head == "var":
+                self.declare_vars(t[1:])
+            elif head == "const" and len(t) == 4 and t[2] == "=":
+                self.consts[t[1]] = self.number(t[3])
+            elif head == "data" and len(t) >= 2:
+                raw = bytes(int(x, 16) for x in t[2:])
+                if len(raw) > BLOCK_PAYLOAD:
+                    self.err(f"data '{t[1]}' has {len(raw)} bytes, a block holds {BLOCK_PAYLOAD}")
+                self.data[t[1]] = (self.blocks - 1 - len(self.data), raw)
+            elif head == "sub" and len(t) == 3 and t[2] == "{":
+                if self.code is not self.main:
+                    self.err("sub inside sub")
+                self.subs[t[1]] = self.line
+                self.code = self.sub_code
+                self.label("s_" + t[1])
+                i = self.block(lines, i + 1)
+                self.emit(RET)
+                self.code = self.main
+            else:
+                i = self.statement(t, lines, i)
+                continue
+            i += 1
+        if self.title is None:
+            raise CompileError(0, "missing 'app SLOT ID \"NAME\"'")
+        self.line = lines[-1][0] if lines else 0
+        # The app idles when main runs out; subroutines follow
+        idle = self.new_label()
+        self.label(idle)
+        self.emit(FRAME)
+        self.emit(JMP, (), idle)
+        code = self.main + self.sub_code
+        known = {c.name for c in code if c.op is None}
+        for c in code:
+            if c.target is not None and c.target not in known:
+                self.line = c.line
+                self.err(f"undefined {'subroutine' if c.target.startswith('s_') else 'label'} '{c.target[2:]}'")
+        return code
+
+    def declare_vars(self, names):
+        """var NAME [NAME@ID] ...; without @ID the lowest free variable is used"""
+        names = [n for n in names if n != ","]
+        k = 0
+        while k < len(names):
+            name = names[k]
+            if names[k + 1:k + 2] == ["@"] and k + 2 < len(names):
+                vid = self.number(names[k + 2])
+                k += 3
+            else:
+                used = set(self.vars.values())
+                vid = next((v for v in range(64) if v not in used), None)
+                k += 1
+            if vid is None or not 0 <= vid < 64:
+                self.err(f"no free variable for '{name}' (64 max)")
+            self.vars[name] = vid
+
+
+# --- Peephole ---
+
+def real_after(code, i):
+    """Index of the first instruction at or after i that is not a label."""
+    while i < len(code) and code[i].op is None:
+        i += 1
+    return i
+
+
+def labels_before(code, i):
+    """Label names between the previous instruction and instruction i."""
+    names = set()
+    j = i - 1
+    while j >= 0 and code[j].op is None:
+        names.add(code[j].name)
+        j -= 1
+    return names
+
+
+def invert_jump(ins):
+    """Same jump on the negated condition, or None if that needs two."""
+    a = ins.args
+    if ins.op == JEQ:
+        return Ins(JNE, a, ins.target, ins.line, ins.tags)
+    if ins.op == JNE:
+        return Ins(JEQ, a, ins.target, ins.line, ins.tags)
+    if ins.op == JGT and a[1] < 255:
+        return Ins(JLT, (a[0], a[1] + 1), ins.target, ins.line, ins.tags)
+    if ins.op == JLT and a[1] > 0:
+        return Ins(JGT, (a[0], a[1] - 1), ins.target, ins.line, ins.tags)
+    if ins.op == JCMP and a[2] in (JCMP_EQ, JCMP_NE):
+        return Ins(JCMP, (a[0], a[1], a[2] ^ 1), ins.target, ins.line, ins.tags)
+    return None
+
+
+def peephole(code, keep):
+    """Rewrites code in place until nothing changes; keep = labels never dropped."""
+    changed = True
+    passes = 0
+    while changed and passes < 50:
+        changed = False
+        passes += 1
+        where = {c.name: k for k, c in enumerate(code) if c.op is None}
+
+        # Jump threading: a branch to a JMP goes straight to that JMP's target
+        for c in code:
+            if c.target is None or c.op == CALL:
+                continue
+            for _ in range(8):
+                k = real_after(code, where[c.target] + 1)
+                if k < len(code) and code[k].op == JMP and code[k].target != c.target:
+                    c.target = code[k].target
+                    changed = True
+                else:
+                    break
+
+        out = []
+        i = 0
+        while i < len(code):
+            c = code[i]
+            j = real_after(code, i + 1)
+            nxt = code[j] if j < len(code) else None
+            adjacent = nxt is not None and j == i + 1
+            # JMP to the next instruction
+            if c.op == JMP and c.target in labels_before(code, j):
+                changed = True
+                i += 1
+                continue
+            # Jcc L1; JMP L2; L1:  ->  J!cc L2; L1:
+            if c.op in BRANCHES and c.op not in (JMP, CALL, HIT) and adjacent and nxt.op == JMP:
+                k = real_after(code, j + 1)
+                inv = invert_jump(c)
+                if inv and c.target in labels_before(code, k):
+                    inv.target = nxt.target
+                    out.append(inv)
+                    changed = True
+                    i = j + 1
+                    continue
+            # Tail call
+            if c.op == CALL and adjacent and nxt.op == RET:
+                out.append(Ins(JMP, (), c.target, c.line, c.tags))
+                changed = True
+                i = j
+                continue
+            # No-ops
+            if (c.op in (ADD, SUB) and c.args[1] == 0) or (c.op in (MUL, DIV) and c.args[1] == 1) \
+                    or (c.op == MOV and c.args[0] == c.args[1]):
+                changed = True
+                i += 1
+                continue
+            # Constant folding on one variable
+            if adjacent and c.op in (SET, ADD, SUB) and nxt.op in (SET, ADD, SUB) and c.args[0] == nxt.args[0]:
+                a = c.args[0]
+                delta = lambda x: x.args[1] if x.op == ADD else -x.args[1]
+                if nxt.op == SET:
+                    merged = Ins(SET, nxt.args, None, nxt.line, nxt.tags)
+                elif c.op == SET:
+                    merged = Ins(SET, (a, (c.args[1] + delta(nxt)) & 0xFF), None, c.line, c.tags)
+                else:
+                    merged = Ins(ADD, (a, (delta(c) + delta(nxt)) & 0xFF), None, c.line, c.tags)
+                out.append(merged)
+                changed = True
+                i = j + 1
+                continue
+            out.append(c)
+            i += 1
+
+        out = reachable(out)
+        used = {c.target for c in out if c.target is not None} | keep
+        code[:] = [c for c in out if c.op is not None or c.name in used]
+        if len(code) != len(out):
+            changed = True
+    return code
+
+
+def reachable(code):
+    """Drops instructions no path from the start or a subroutine reaches."""
+    where = {c.name: k for k, c in enumerate(code) if c.op is None}
+    todo = [0] + [k for name, k in where.items() if name.startswith("s_")]
+    seen = set()
+    while todo:
+        k = todo.pop()
+        if k >= len(code) or k in seen:
+            continue
+        seen.add(k)
+        c = code[k]
+        if c.op is None or c.falls():
+            todo.append(k + 1)
+        if c.target is not None:
+            todo.append(where[c.target])
+    return [c for k, c in enumerate(code) if c.op is None or k in seen]
+
+
+# --- Layout ---
+
+def layout(code, n_data, n_blocks=BLOCKS):
+    """Packs instructions into 22-byte blocks from block 0. An instruction that
+    falls through always leaves room for the JMP into the next block, so
+    execution never runs through the 10 NOP bytes of a block boundary. A loop
+    that fits in one block starts a fresh block rather than paying a link
+    JMP on every iteration."""
+    ins = [c for c in code if c.op is not None]
+    blocks = [[]]
+    used = 0
+    pending = []               # Labels waiting for their instruction
+    prev = ()
+    k = -1
+    for c in code:
+        if c.op is None:
+            pending.append(c)
+            continue
+        k += 1
+        n = c.length()
+        entered = [lid for lid in c.tags if lid not in prev]
+        prev = c.tags
+        span = next((sz for sz in (loop_span(ins, k, lid) for lid in entered)
+                     if sz + 3 <= BLOCK_PAYLOAD), 0)
+        if used + max(n, span) + (3 if c.falls() or span else 0) > BLOCK_PAYLOAD:
+            last = next((x for x in reversed(blocks[-1]) if x.op is not None), None)
+            if last is not None and last.falls():
+                link = f"_B{len(blocks)}"
+                blocks[-1].append(Ins(JMP, (), link, last.line, last.tags))
+                blocks.append([Ins(None, name=link, tags=last.tags)])
+            else:
+                blocks.append([])
+            used = 0
+        blocks[-1] += pending + [c]
+        pending = []
+        used += n
+    blocks[-1] += pending
+    if len(blocks) + n_data > n_blocks:
+        raise CompileError(0, f"{len(blocks)} code blocks + {n_data} data blocks exceed {n_blocks}")
+    where = {}
+    for b, blk in enumerate(blocks):
+        pc = b * 32 + 9
+        for c in blk:
+            c.addr = pc
+            if c.op is None:
+                where[c.name] = pc
+            else:
+                pc += c.length()
+    return blocks, where
+
+
+def loop_span(ins, k, lid):
+    """Bytes of the run of instructions from ins[k] that belong to loop lid"""
+    size = 0
+    while k < len(ins) and lid in ins[k].tags:
+        size += ins[k].length()
+        k += 1
+    return size
+
+
+def encode(c, where):
+    out = [c.op] + c.args
+    if c.target is not None:
+        out += [where[c.target] >> 8, where[c.target] & 0xFF]
+    return out
+
+
+def block_name(blk, b):
+    for c in blk:
+        if c.op is None and not c.name.startswith("_"):
+            return c.name[2:].upper()[:8]
+    return f"CODE{b:02d}"
+
+
+# --- Frame Budget Analysis ---
+
+class Analysis:
+    """Longest instruction paths between FRAME yields on the laid-out code.
+    Every record the decoded VM executes counts 1, as vm_frame_ops does.
+    Loops without a FRAME are collapsed into one node costing
+    bound * iteration + exit; without a 'max N' bound they are unbounded."""
+
+    def __init__(self, code, where, loops, subs):
+        self.nodes = [c for c in code if c.op is not None]
+        self.index = {id(c): k for k, c in enumerate(self.nodes)}
+        at = {c.addr: k for k, c in enumerate(self.nodes)}
+        self.label_node = {name: at.get(addr) for name, addr in where.items()}
+        self.succ = []
+        for k, c in enumerate(self.nodes):
+            s = []
+            if c.falls() and c.op != CALL and k + 1 < len(self.nodes):
+                s.append(k + 1)
+            if c.op == CALL:
+                s.append(k + 1)
+            elif c.target is not None:
+                s.append(self.label_node[c.target])
+            self.succ.append(s)
+        self.loops = loops
+        self.subs = subs
+        self.memo = {}
+        self.busy = set()
+        self.summ = {}
+        self.unbounded = set()   # Source lines of loops or cycles without a bound
+        for k, c in enumerate(self.nodes):
+            for lid in c.tags:
+                loops[lid].nodes.append(k)
+        self.mark_yields()
+
+    # Which subs and loops can reach a FRAME
+    def reach(self, start):
+        seen, todo = set(), [start]
+        while todo:
+            k = todo.pop()
+            if k is None or k in seen:
+                continue
+            seen.add(k)
+            if self.nodes[k].op != RET:
+                todo += self.succ[k]
+        return seen
+
+    def mark_yields(self):
+        sub_nodes = {name: self.reach(self.label_node["s_" + name]) for name in self.subs}
+        self.sub_yields = {name: False for name in self.subs}
+        changed = True
+        while changed:
+            changed = False
+            for name, ns in sub_nodes.items():
+                if not self.sub_yields[name] and any(self.yields_at(k) for k in ns):
+                    self.sub_yields[name] = changed = True
+        for L in self.loops.values():
+            L.yields = any(self.yields_at(k) for k in L.nodes)
+            L.collapsed = bool(L.nodes) and not L.yields
+
+    def yields_at(self, k):
+        c = self.nodes[k]
+        return c.op == FRAME or (c.op == CALL and self.sub_yields.get(c.target[2:], False))
+
+    def rep(self, k, within=None):
+        tags = self.nodes[k].tags
+        if within is not None and within not in tags:
+            return k
+        start = tags.index(within) + 1 if within is not None else 0
+        for lid in tags[start:]:
+            if self.loops[lid].collapsed:
+                return ("L", lid)
+        return k
+
+    # Sub summary: (through: entry->RET, pre: entry->FRAME, post: FRAME->RET)
+    def summary(self, name):
+        if name in self.summ:
+            return self.summ[name]
+        if ("sub", name) in self.busy:
+            self.unbounded.add(self.subs[name])
+            return (INF, INF, INF)
+        self.busy.add(("sub", name))
+        entry = self.label_node["s_" + name]
+        thr = self.val(self.rep(entry), "R")
+        pre = self.val(self.rep(entry), "F")
+        post = NEG
+        for k in self.reach(entry):
+            c = self.nodes[k]
+            if c.op == FRAME and k + 1 < len(self.nodes):
+                post = max(post, self.val(self.rep(k + 1), "R"))
+            elif c.op == CALL and self.sub_yields.get(c.target[2:]):
+                post = max(post, add(self.summary(c.target[2:])[2], self.val(self.rep(k + 1), "R")))
+        self.busy.discard(("sub", name))
+        self.summ[name] = (thr, pre, post)
+        return self.summ[name]
+
+    def node_cost(self, k):
+        c = self.nodes[k]
+        if c.op == CALL:
+            return add(1, self.summary(c.target[2:])[0])
+        return 1
+
+    def exits(self, lid, within):
+        L = self.loops[lid]
+        outs = set()
+        for k in L.nodes:
+            for s in self.succ[k]:
+                if s is not None and lid not in self.nodes[s].tags:
+                    outs.add(self.rep(s, within))
+        return outs
+
+    # F: longest path to a FRAME (or halt); R: longest path to a RET, no FRAME on the way
+    def val(self, x, kind):
+        key = (x, kind)
+        if key in self.memo:
+            return self.memo[key]
+        if key in self.busy:
+            self.unbounded.add(self.line_of(x))
+            return INF
+        self.busy.add(key)
+        if isinstance(x, tuple):
+            lid = x[1]
+            cost, rt = self.loop_cost(lid)
+            best = max([self.val(e, kind) for e in self.exits(lid, None)], default=NEG)
+            v = INF if cost == INF else add(cost, best)   # Unbounded spins even with no exit
+            if kind == "R":
+                v = max(v, rt)
+        else:
+            c = self.nodes[x]
+            succ = [self.rep(s) for s in self.succ[x] if s is not None]
+            if c.op == FRAME:
+                v = 1 if kind == "F" else NEG
+            elif c.op == RET:
+                v = 1 if kind == "R" else NEG
+            elif c.op == CALL and self.sub_yields.get(c.target[2:]):
+                thr, pre, post = self.summary(c.target[2:])
+                v = add(add(1, thr), max([self.val(s, kind) for s in succ], default=NEG))
+                if kind == "F":
+                    v = max(v, add(1, pre))
+            elif not succ:
+                v = 1 if kind == "F" else NEG       # Runs off the code: the VM halts
+            else:
+                v = add(self.node_cost(x), max(self.val(s, kind) for s in succ))
+        self.busy.discard(key)
+        self.memo[key] = v
+        return v
+
+    def line_of(self, x):
+        if isinstance(x, tuple):
+            return self.loops[x[1]].line
+        c = self.nodes[x]
+        return self.loops[c.tags[-1]].line if c.tags else c.line
+
+    # Collapsed loop: (bound * iteration + exit, cost to a RET inside)
+    def loop_cost(self, lid):
+        key = ("loop", lid)
+        if key in self.memo:
+            return self.memo[key]
+        L = self.loops[lid]
+        entry = self.rep(self.label_node[L.entry], lid)
+        walk = {}
+
+        def go(x, mode):
+            k2 = (x, mode)
+            if k2 in walk:
+                return walk[k2]
+            if k2 in self.busy:
+                self.unbounded.add(self.line_of(x))
+                return INF
+            self.busy.add(k2)
+            if isinstance(x, tuple):
+                cost, rt = self.loop_cost(x[1])
+                outs = self.exits(x[1], lid)
+                own = rt if mode == "T" else NEG
+            else:
+                c = self.nodes[x]
+                cost = self.node_cost(x)
+                outs = {self.rep(s, lid) for s in self.succ[x] if s is not None}
+                own = cost if (mode == "T" and c.op == RET) else NEG
+                if c.op == RET:
+                    outs = set()
+            best = NEG
+            for o in outs:
+                inside = isinstance(o, tuple) or lid in self.nodes[o].tags
+                if o == entry:
+                    best = max(best, 0 if mode == "I" else NEG)
+                elif not inside:
+                    best = max(best, 0 if mode == "E" else NEG)
+                else:
+                    best = max(best, go(o, mode))
+            v = max(own, add(cost, best))
+            self.busy.discard(k2)
+            walk[k2] = v
+            return v
+
+        it, ex, rt = go(entry, "I"), go(entry, "E"), go(entry, "T")
+        if it == NEG:              # Never comes back round
+            total = ex
+        elif L.bound is None:
+            self.unbounded.add(L.line)
+            total = rt = INF
+        else:
+            total = add(L.bound * it, ex)
+            rt = add(L.bound * it, rt)
+        L.iteration = it
+        L.total = total
+        self.memo[key] = (total, rt)
+        return self.memo[key]
+
+    def segments(self):
+        """[(description, line, loop tags, worst ops)] for every frame start"""
+        out = [("start", 0, (), add(HEADER_NOPS, self.val(self.rep(0), "F")))]
+        for k, c in enumerate(self.nodes):
+            if c.op == FRAME and k + 1 < len(self.nodes):
+                out.append(("after frame", c.line, c.tags, self.val(self.rep(k + 1), "F")))
+            elif c.op == CALL and self.sub_yields.get(c.target[2:]):
+                post = self.summary(c.target[2:])[2]
+                out.append((f"after call {c.target[2:]}", c.line, c.tags, add(post, self.val(self.rep(k + 1), "F"))))
+        return [s for s in out if s[3] != NEG]
+
+
+def add(a, b):
+    if a == NEG or b == NEG:
+        return NEG
+    return a + b
+
+
+def fmt(v):
+    return "UNBOUNDED" if v == INF else str(v)
+
+
+# --- Driver ---
+
+def build(text, optimize=True, slots=1):
+    comp = Compiler(BLOCKS * slots)
+    code = comp.compile(text)
+    before = sum(1 for c in code if c.op is not None)
+    keep = {L.entry for L in comp.loops.values()} | {"s_" + s for s in comp.subs}
+    if optimize:
+        peephole(code, keep)
+    after = sum(1 for c in code if c.op is not None)
+    blocks, where = layout(code, len(comp.data), comp.blocks)
+    flat = [c for blk in blocks for c in blk]
+    ana = Analysis(flat, where, comp.loops, comp.subs)
+    return comp, blocks, where, ana, (before, after)
+
+
+def write_code_txt(path, src, comp, blocks, where):
+    slot, dev_id, name = comp.title
+    with open(path, "w", encoding="utf-8", newline="\r\n") as f:
+        f.write(f"# Generated by gemc.py from {src}\n\n")
+        if comp.appver:
+            f.write(f"APPVER,{comp.appver[0]},{comp.appver[1]}\n\n")
+        f.write(f"TITLE,{slot:02d},{dev_id:02X},{name}\n\n")
+        for b, blk in enumerate(blocks):
+            payload = []
+            for c in blk:
+                if c.op is not None:
+                    payload += encode(c, where)
+            payload += [0x20] * (BLOCK_PAYLOAD - len(payload))
+            f.write(f"PAYLOAD,{slot:02d},{b},{block_name(blk, b):<8},22,{bytes(payload).hex().upper()}\n")
+        for dname, (b, raw) in sorted(comp.data.items(), key=lambda d: d[1][0]):
+            payload = bytes(raw) + b"\x20" * (BLOCK_PAYLOAD - len(raw))
+            f.write(f"PAYLOAD,{slot:02d},{b},{dname.upper()[:8]:<8},22,{payload.hex().upper()}\n")
+
+
+def listing(blocks, where):
+    for b, blk in enumerate(blocks):
+        for c in blk:
+            if c.op is None:
+                print(f"{'':>10}{c.name[2:] if c.name[:2] in ('u_', 's_') else c.name}:")
+            else:
+                raw = " ".join(f"{x:02X}" for x in encode(c, where))
+                print(f"  {b:02d}:{c.addr:04X}  {raw:<20} line {c.line}")
+
+
+def report(comp, blocks, ana, counts, cap):
+    before, after = counts
+    links = len(ana.nodes) - after
+    print(f"Code    : {after} instructions ({before} before peephole) + {links} block links, "
+          f"{len(blocks)} code blocks + {len(comp.data)} data")
+    segs = ana.segments()
+    worst = max((s[3] for s in segs), default=0)
+    print(f"Frames  : worst {fmt(worst)} ops per frame (cap {cap})")
+    for what, line, _, v in segs:
+        where = f"{what} @ line {line}" if line else what
+        print(f"  {where:<24}: {fmt(v)}")
+    if comp.loops:
+        print("Loops   :")
+    for L in comp.loops.values():
+        desc = f"line {L.line} {L.kind}" + (f" (max {L.bound})" if L.bound is not None else "")
+        if not L.nodes:
+            print(f"  {desc:<24}: removed (never runs)")
+        elif L.collapsed:
+            ana.loop_cost(L.lid)
+            print(f"  {desc:<24}: no frame, {fmt(L.iteration)} ops/iteration, {fmt(L.total)} ops worst")
+        else:
+            w = max((s[3] for s in segs if L.lid in s[2]), default=NEG)
+            print(f"  {desc:<24}: frame in body, worst {fmt(w)} ops per frame")
+    for line in sorted(ana.unbounded):
+        print(f"WARNING : line {line}: a path can loop without a FRAME; add one or a 'max N' bound")
+    if worst != INF and worst > cap:
+        print(f"WARNING : a frame can run {worst} ops, over the {cap}-op cap")
+    return worst
+
+
+def main():
+    ap = argparse.ArgumentParser(description="GemOS cartridge compiler")
+    ap.add_argument("source")
+    ap.add_argument("-o", "--output", default="CODE.TXT")
+    ap.add_argument("-O0", dest="optimize", action="store_false", help="skip the peephole pass")
+    ap.add_argument("-l", "--list", action="store_true", help="print the placed code")
+    ap.add_argument("--cap", type=int, default=VM_OP_CAP, help="ops per frame to warn above")
+    ap.add_argument("--slots", type=int, default=1, choices=range(1, SPAN_MAX + 1),
+                    help="slots the cartridge may span (blocks past 58 go to ID 0xFE slots)")
+    args = ap.parse_args()
+
+    sys.setrecursionlimit(10000)
+    with open(args.source, encoding="utf-8") as f:
+        text = f.read()
+    try:
+        comp, blocks, where, ana, counts = build(text, args.optimize, args.slots)
+    except CompileError as e:
+        print(f"{args.source}:{e.line}: error: {e}")
+        return 1
+    write_code_txt(args.output, args.source, comp, blocks, where)
+    print(f"gemc    : {args.source} -> {args.output}")
+    if args.list:
+        listing(blocks, where)
+    report(comp, blocks, ana, counts, args.cap)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,43 @@
+# *********************************************************************************
+# Project Name : GemOS Build Flag Test
+# Version      : 1.00
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Compiles GemOS_006_070.c against the host shim (host/debug.h) with the
+# feature flags in their defaults and flipped, warnings as errors. The host
+# tools never build OLED_HW_I2C 1 or VM_BENCH 1, so this is the only check
+# those branches get off the board.
+#
+# Usage (from CH32V006_GemOS):
+#   python3 host/build_test.py
+#
+# [Change History]
+# V1.00 - Initial test.
+# *********************************************************************************
+
+import os
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+
+CONFIGS = (
+    ("defaults", []),
+    ("OLED_HW_I2C", ["-DOLED_HW_I2C=1"]),
+    ("profilers", ["-DVM_BENCH=1", "-DVM_PROF=1", "-DFT_PROF=1", "-DIN_REC=1"]),
+    ("time budget", ["-DVM_SCHED_TIME=1", "-DVM_SNAP=0"]),
+)
+
+ok = True
+for name, flags in CONFIGS:
+    res = subprocess.run(["gcc", "-fsyntax-only", "-Wall", "-Wextra", "-Werror", "-funsigned-char",
+                          "-I", HERE, *flags, os.path.join(ROOT, "GemOS_006_070.c")],
+                         capture_output=True, text=True)
+    print(f"{name:12s}: {'OK' if res.returncode == 0 else 'FAIL'}")
+    if res.returncode:
+        print(res.stderr)
+        ok = False
+
+sys.exit(0 if ok else 1)
@@ -0,0 +1,75 @@
+# *********************************************************************************
+# Project Name : GemOS Code Cache Test
+# Version      : 1.01
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Compiles a two-slot cartridge with gemc.py --slots 2 (80 tile blocks, most
+# of them in the ID 0xFE continuation slot, so the renderer needs far more
+# blocks than the code cache holds), runs it through host/gemos_run.c and
+# compares the final screen with one drawn here from the tile data. Also
+# checks that the continuation slot does not start as an app of its own, and
+# that a cart with more starts than VM_REC_MAX runs on the per-step path.
+#
+# Usage (from CH32V006_GemOS):
+#   python3 host/cache_test.py
+#
+# [Change History]
+# V1.01 - Build, run and PBM helpers from host/cart_fixture.py.
+# V1.00 - Initial test.
+# *********************************************************************************
+
+import re
+import sys
+
+sys.dont_write_bytecode = True
+import cart_fixture as fx
+
+TILES = 80
+
+
+def tile(k):
+    return bytes([(k * 37 + j * 11) & 0xFF | 1 << (j & 7) for j in range(8)])
+
+
+def source():
+    body = ["melody s00 50", "melody s79 50", "i = 0", f"t = s{TILES - 1:02d}",
+            "while i < 128 max 128 {", "map[i] = t", "t += 1",
+            "if t > s00 {", f"t = s{TILES - 1:02d}", "}", "i += 1", "frame", "}",
+            "loop {", "frame", "}"]
+    return fx.tile_source('app 04 7B "CACHE TEST"', ["i", "t"], TILES, tile, body)
+
+
+def expected(comp):
+    """Map cell i holds block (lowest + i % TILES); each tile is 8 page columns"""
+    fb = [[0] * 128 for _ in range(8)]
+    by_block = {blk: raw for blk, raw in comp.data.values()}
+    lowest = min(by_block)
+    for i in range(128):
+        raw = by_block[lowest + i % TILES]
+        for j in range(8):
+            fb[i >> 4][(i & 15) * 8 + j] = raw[j]
+    return fx.pbm(fb)
+
+
+comp, blocks, code = fx.compile_cart(source(), "cache_test")
+out, screen = fx.gemos_run("-d", "-n", "300", "-c", code, fx.IMAGE, "04")
+cache = re.search(r"Cache   : .*, ([\d.]+)% hit, (\d+) refills", out)
+# The code sits in the first slot, so the two-slot cart is pre-decoded too
+ok = ("118 blocks in 2 slot(s)" in out and "per-step decode" not in out and "Fault" not in out
+      and cache is not None and int(cache.group(2)) > 0 and screen == expected(comp))
+print(f"{'two-slot':10s}: {len(blocks)} code + {len(comp.data)} data blocks, "
+      f"{cache.group(1) if cache else '?'}% hit, {cache.group(2) if cache else '?'} refills, "
+      f"{'OK' if ok else 'FAIL'}")
+
+out, _ = fx.gemos_run("-n", "10", "-c", code, fx.IMAGE, "05")
+cont = "not an app" in out and re.search(r"Frames  : 0\b", out) is not None
+print(f"{'cont slot':10s}: {'OK' if cont else 'FAIL'}")
+
+# More starts than VM_REC_MAX records: the frame pass decodes per step
+body = ["a = rand 50" if k % 2 else "b = rand 9" for k in range(330)] + ["loop {", "frame", "}"]
+_, _, code = fx.compile_cart('app 04 7B "PER STEP"\nvar a b\n' + "\n".join(body) + "\n", "step", 1)
+out, _ = fx.gemos_run("-n", "20", "-c", code, fx.IMAGE, "04")
+step = "per-step decode" in out and "Fault" not in out and "Ops     : 427 total" in out
+print(f"{'per-step':10s}: {'OK' if step else 'FAIL'}")
+sys.exit(0 if ok and cont and step else 1)
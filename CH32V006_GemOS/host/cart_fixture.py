@@ -0,0 +1,83 @@
+# *********************************************************************************
+# Project Name : GemOS Cartridge Test Fixture
+# Version      : 1.01
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Shared by the host tests that build their own gemc.py cartridge: writes a
+# source with one "data sNN" block per tile, compiles it into CODE.TXT,
+# builds host/gemos_run.c once and runs it with the final screen captured
+# as PBM, and draws the PBM a page framebuffer should give.
+#
+# Usage (from a host/*_test.py):
+#   import cart_fixture as fx
+#   comp, blocks, code = fx.compile_cart(fx.tile_source(...), "name")
+#   out, screen = fx.gemos_run("-n", "300", "-c", code, fx.IMAGE, "04")
+#
+# [Change History]
+# V1.01 - The temp dir is removed when the test exits.
+# V1.00 - Fixture taken out of cache_test, pack_test and snap_test.
+# *********************************************************************************
+
+import atexit
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+sys.dont_write_bytecode = True
+sys.path.insert(0, ROOT)
+import gemc
+
+IMAGE = os.path.join(ROOT, "2026_05_03_EEPROM.bin")
+# Stick moves and A/B presses that keep OTHELLO and B_BREAKER busy
+KEYS = "30 0 0 -\n5 0 0 A\n40 2 1 -\n5 0 0 A\n30 -1 2 A\n60 1 -1 -\n5 0 0 B\n"
+
+tmp = tempfile.mkdtemp()
+atexit.register(shutil.rmtree, tmp, True)
+_exe = None
+
+
+def tile_source(app, names, tiles, tile, body):
+    """gemc source: app line, vars, one 'data sNN' block per tile(k), then body"""
+    lines = [app, "var " + " ".join(names)]
+    lines += [f"data s{k:02d} " + " ".join(f"{b:02X}" for b in tile(k)) for k in range(tiles)]
+    return "\n".join(lines + body) + "\n"
+
+
+def compile_cart(src, name, slots=2):
+    """Optimized build of src as tmp/name.txt; returns (comp, blocks, path)"""
+    comp, blocks, where, _, _ = gemc.build(src, True, slots)
+    path = os.path.join(tmp, name + ".txt")
+    gemc.write_code_txt(path, name, comp, blocks, where)
+    return comp, blocks, path
+
+
+def write(name, data):
+    """Writes text or bytes into the temp dir; returns the path"""
+    path = os.path.join(tmp, name)
+    with open(path, "w" if isinstance(data, str) else "wb") as f:
+        f.write(data)
+    return path
+
+
+def gemos_run(*args):
+    """Runs host/gemos_run.c -q with args; returns (stdout, final screen as PBM)"""
+    global _exe
+    if _exe is None:
+        _exe = os.path.join(tmp, "gemos_run")
+        subprocess.check_call(["gcc", "-O2", "-funsigned-char", "-I", HERE, "-o", _exe,
+                               os.path.join(HERE, "gemos_run.c")])
+    pbm = os.path.join(tmp, "out.pbm")
+    out = subprocess.run([_exe, "-q", "-o", pbm, *args], check=True, capture_output=True, text=True).stdout
+    with open(pbm, "rb") as f:
+        return out, f.read()
+
+
+def pbm(fb):
+    """The PBM gemos_run -o writes for 8 pages of 128 column bytes"""
+    rows = ["".join("1" if (fb[y >> 3][x] >> (y & 7)) & 1 else "0" for x in range(128)) for y in range(64)]
+    return ("P1\n128 64\n" + "\n".join(rows) + "\n").encode()
@@ -0,0 +1,115 @@
+/*********************************************************************************
+ * Project Name : GemOS Host Shim (debug.h replacement)
+ * Version      : 1.03
+ * Date         : 2026-10-16
+ * Developers   : yas & Gemini
+ *
+ * Stands in for the WCH SDK "debug.h" when GemOS_006_070.c is compiled on a
+ * PC by the host tools. Peripheral registers are plain RAM structs, delays are
+ * no-ops and GEMOS_HOST swaps the EEPROM driver for a RAM image and the serial
+ * link for a file descriptor.
+ *
+ * [Change History]
+ * V1.03 - I2C1 and DMA1 channel 6, so the OLED_HW_I2C 1 path compiles on the
+ * host (registers only; the host tools still build with OLED_HW_I2C 0).
+ * V1.02 - TIM1 and the update interrupt bits for the sound sequencer.
+ * V1.01 - host_uart_fd: s_getc()/s_avail()/print_char() on a pseudo-terminal
+ * for host/gemos_link.c.
+ * V1.00 - Initial shim for the headless VM runner.
+ *********************************************************************************/
+
+#ifndef GEMOS_HOST_DEBUG_H
+#define GEMOS_HOST_DEBUG_H
+
+#include <poll.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define GEMOS_HOST 1
+
+#define __IO volatile
+
+typedef struct { __IO uint32_t CFGLR, CFGHR, INDR, OUTDR, BSHR, BCR, LCKR; } GPIO_TypeDef;
+typedef struct { __IO uint32_t STATR, DATAR, BRR, CTLR1, CTLR2, CTLR3, GPR; } USART_TypeDef;
+typedef struct { __IO uint32_t CTLR, CFGR0, INTR, APB2PRSTR, APB1PRSTR, AHBPCENR, PB2PCENR, PB1PCENR, RSTSCKR; } RCC_TypeDef;
+typedef struct { __IO uint32_t CTLR1, CTLR2, SMCFGR, DMAINTENR, INTFR, SWEVGR, CHCTLR1, CHCTLR2, CCER, CNT, PSC, ATRLR, RPTCR, CH1CVR, CH2CVR, CH3CVR, CH4CVR, BDTR, DMACFGR, DMAADR; } TIM_TypeDef;
+typedef struct { __IO uint32_t CTLR1, CTLR2, OADDR1, OADDR2, DATAR, STAR1, STAR2, CKCFGR, RTR; } I2C_TypeDef;
+typedef struct { __IO uint32_t INTFR, INTFCR; } DMA_TypeDef;
+typedef struct { __IO uint32_t CFGR, CNTR, PADDR, MADDR; } DMA_Channel_TypeDef;
+typedef struct { __IO uint32_t STATR, CTLR1, CTLR2, SAMPTR1, SAMPTR2, IOFR1, IOFR2, IOFR3, IOFR4, WDHTR, WDLTR, RSQR1, RSQR2, RSQR3, ISQR, IDATAR1, IDATAR2, IDATAR3, IDATAR4, RDATAR; } ADC_TypeDef;
+typedef struct { __IO uint32_t CTLR, SR, CNT, CMP; } SysTick_Type;
+
+static GPIO_TypeDef  host_gpioa, host_gpioc, host_gpiod;
+static USART_TypeDef host_usart1 = { .STATR = (1 << 7) | (1 << 6) };
+static RCC_TypeDef   host_rcc;
+static TIM_TypeDef   host_tim1, host_tim2;
+static ADC_TypeDef   host_adc1 = { .STATR = (1 << 1), .RDATAR = 512 };
+/* Only touched with OLED_HW_I2C 1 */
+__attribute__((unused)) static I2C_TypeDef host_i2c1;
+__attribute__((unused)) static DMA_TypeDef host_dma1;
+__attribute__((unused)) static DMA_Channel_TypeDef host_dma1_ch6;
+static SysTick_Type  host_systick;
+
+#define GPIOA   (&host_gpioa)
+#define GPIOC   (&host_gpioc)
+#define GPIOD   (&host_gpiod)
+#define USART1  (&host_usart1)
+#define RCC     (&host_rcc)
+#define TIM1    (&host_tim1)
+#define TIM2    (&host_tim2)
+#define ADC1    (&host_adc1)
+#define I2C1    (&host_i2c1)
+#define DMA1    (&host_dma1)
+#define DMA1_Channel6 (&host_dma1_ch6)
+#define SysTick (&host_systick)
+
+#define RCC_AFIOEN   (1 << 0)
+#define RCC_IOPAEN   (1 << 2)
+#define RCC_IOPCEN   (1 << 4)
+#define RCC_IOPDEN   (1 << 5)
+#define RCC_ADC1EN   (1 << 9)
+#define RCC_USART1EN (1 << 14)
+#define RCC_TIM1EN   (1 << 11)
+#define RCC_TIM2EN   (1 << 0)
+#define RCC_I2C1EN   (1 << 21)
+#define RCC_DMA1EN   (1 << 0)
+
+#define TIM_CEN      (1 << 0)
+#define TIM_ARPE     (1 << 7)
+#define TIM_UIE      (1 << 0)
+#define TIM_UIF      (1 << 0)
+#define ADC_ADON     (1 << 0)
+#define ADC_EOC      (1 << 1)
+#define ADC_SWSTART  (1 << 22)
+
+typedef enum { TIM1_UP_IRQn = 35, USART1_IRQn = 32 } IRQn_Type;
+static inline void NVIC_EnableIRQ(IRQn_Type n) { (void)n; }
+
+/* Serial link (host/gemos_link.c): USART1 bytes go through a file descriptor.
+ * -1 (host/gemos_run.c) reads nothing and drops everything sent. */
+static int host_uart_fd = -1;
+static int host_uart_timeout_ms = 500;
+
+static inline int16_t host_uart_getc(void) {
+    uint8_t c;
+    struct pollfd p = { .fd = host_uart_fd, .events = POLLIN };
+    if(host_uart_fd < 0 || poll(&p, 1, host_uart_timeout_ms) <= 0) return -1;
+    if(read(host_uart_fd, &c, 1) != 1) return -1;
+    return c;
+}
+
+static inline int host_uart_avail(void) {
+    struct pollfd p = { .fd = host_uart_fd, .events = POLLIN };
+    return host_uart_fd >= 0 && poll(&p, 1, 0) > 0;
+}
+
+static inline void host_uart_putc(uint8_t c) {
+    if(host_uart_fd >= 0 && write(host_uart_fd, &c, 1) != 1) host_uart_fd = -1;
+}
+
+static inline void SystemInit(void) {}
+static inline void Delay_Init(void) {}
+static inline void Delay_Us(uint32_t n) { (void)n; }
+static inline void Delay_Ms(uint32_t n) { (void)n; }
+
+#endif
@@ -0,0 +1,102 @@
+# *********************************************************************************
+# Project Name : GemOS Cartridge Compiler Test
+# Version      : 1.01
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Compiles host/gemc_sample.gem with gemc.py, with and without the peephole
+# pass, runs both through host/gemos_run.c (the firmware's VM) with scripted
+# input, and checks that the measured ops per frame stay within the compiler's
+# worst-case figure, that no frame hits the runaway limit, and that both
+# builds leave the same screen. Also checks a few peephole and analysis cases.
+#
+# Usage (from CH32V006_GemOS):
+#   python3 host/gemc_test.py
+#
+# [Change History]
+# V1.01 - Ray step range cases (emit of RAY_FLIP).
+# V1.00 - Initial test.
+# *********************************************************************************
+
+import contextlib
+import io
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+sys.dont_write_bytecode = True
+sys.path.insert(0, ROOT)
+import gemc
+
+# Paddle sweeps both ways, the reset button is pressed twice
+INPUT = "120 2 0 -\n5 0 0 A\n200 -3 0 -\n5 0 0 A\n300 1 0 -\n"
+
+
+def run(label, optimize):
+    with open(os.path.join(HERE, "gemc_sample.gem"), encoding="utf-8") as f:
+        comp, blocks, where, ana, counts = gemc.build(f.read(), optimize)
+    code = os.path.join(tmp, f"{label}.txt")
+    gemc.write_code_txt(code, "gemc_sample.gem", comp, blocks, where)
+    with contextlib.redirect_stdout(io.StringIO()):
+        worst = gemc.report(comp, blocks, ana, counts, gemc.VM_OP_CAP)
+    pbm = os.path.join(tmp, f"{label}.pbm")
+    out = subprocess.run([exe, "-q", "-n", "630", "-i", inp, "-c", code, "-o", pbm,
+                          os.path.join(ROOT, "2026_05_03_EEPROM.bin"), "03"],
+                         check=True, capture_output=True, text=True).stdout
+    peak = int(re.search(r"max (\d+) per frame", out).group(1))
+    capped = int(re.search(r"Runaway : (\d+) frames", out).group(1))
+    with open(pbm, "rb") as f:
+        screen = f.read()
+    ok = peak <= worst and capped == 0
+    print(f"{label:10s}: {counts[1]} instructions, {len(blocks)} blocks, "
+          f"worst {worst} / measured {peak} ops per frame, {capped} runaway, {'OK' if ok else 'FAIL'}")
+    return ok, counts[1], screen
+
+
+def check(label, src, test):
+    try:
+        comp, blocks, where, ana, counts = gemc.build('app 03 7A "T"\nvar a b\n' + src)
+        ok = test(comp, blocks, where, ana)
+    except gemc.CompileError as e:
+        ok = test(e, None, None, None)
+    print(f"{label:10s}: {'OK' if ok else 'FAIL'}")
+    return ok
+
+
+def ops(blocks):
+    return [(c.op, c.args) for blk in blocks for c in blk if c.op is not None]
+
+
+tmp = tempfile.mkdtemp()
+exe = os.path.join(tmp, "gemos_run")
+subprocess.check_call(["gcc", "-O2", "-funsigned-char", "-I", HERE, "-o", exe,
+                       os.path.join(HERE, "gemos_run.c")])
+inp = os.path.join(tmp, "input.txt")
+with open(inp, "w") as f:
+    f.write(INPUT)
+
+ok, n_opt, screen_opt = run("optimized", True)
+ok0, n_raw, screen_raw = run("plain", False)
+ok &= ok0 and n_opt <= n_raw and screen_opt == screen_raw
+print(f"{'same':10s}: {'OK' if screen_opt == screen_raw else 'FAIL'}")
+
+# SET then ADD on one variable folds into one SET
+ok &= check("fold", "a = 1\na += 2\nframe\n",
+            lambda comp, blocks, *_: (gemc.SET, [0, 3]) in ops(blocks) and (gemc.ADD, [0, 2]) not in ops(blocks))
+# A loop without FRAME or 'max N' is reported
+ok &= check("unbounded", "loop {\na += 1\n}\n",
+            lambda comp, blocks, where, ana: ana.segments()[0][3] == gemc.INF and bool(ana.unbounded))
+# A bounded loop costs bound * iteration + exit
+ok &= check("bounded", "a = 0\nwhile a < 5 max 5 {\na += 1\n}\nframe\n",
+            lambda comp, blocks, where, ana: (ana.loop_cost(0), comp.loops[0].iteration) == ((11, gemc.NEG), 2))
+# Undefined labels are compile errors
+ok &= check("undefined", "goto nowhere\n", lambda e, *_: isinstance(e, gemc.CompileError))
+# Ray steps: 15 is dx -1 / dy +1; 8 would run as dx -8 of the next row
+ok &= check("ray step", "emit 85 00 01 0F 00 01\nframe\n",
+            lambda comp, blocks, *_: (gemc.RAY_FLIP, [0, 1, 15, 0, 1]) in ops(blocks))
+ok &= check("ray dx 8", "emit 85 00 01 08 00 01\nframe\n", lambda e, *_: isinstance(e, gemc.CompileError))
+sys.exit(0 if ok else 1)
@@ -0,0 +1,98 @@
+/*********************************************************************************
+ * Project Name : GemOS Host Link Device
+ * Version      : 1.00
+ * Date         : 2026-10-16
+ * Developers   : yas & Gemini
+ *
+ * Plays the device end of the binary bulk-upload link on a Linux PC. The
+ * firmware source is compiled in as-is (host/debug.h stands in for the WCH
+ * SDK), so frames are parsed, ACKed and written by the same link_session()
+ * that runs on the CH32V006; USART1 is a pseudo-terminal and the 24LC512 a
+ * RAM image. Used by host/link_test.py together with pc_upload.py.
+ *
+ * Build (from CH32V006_GemOS):
+ *   gcc -O2 -funsigned-char -I host -o gemos_link host/gemos_link.c
+ *
+ * Usage:
+ *   ./gemos_link [-o out.bin] [-i in.bin] /dev/pts/N
+ *     -i FILE   EEPROM image to start from (default: all 0xFF)
+ *     -o FILE   Write the EEPROM image here when the host side hangs up
+ *
+ * [Change History]
+ * V1.00 - Initial link device: sessions on LINK_SOF until the pty closes.
+ *********************************************************************************/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+
+#define VM_SCHED_TIME 0
+#define OLED_HW_I2C 0
+#define main gemos_firmware_main
+#include "../GemOS_006_070.c"
+#undef main
+
+uint8_t host_eeprom[0x10000];
+
+int main(int argc, char **argv) {
+    const char *in_path = NULL;
+    const char *out_path = NULL;
+    int argi = 1;
+    for(; argi < argc && argv[argi][0] == '-'; argi++) {
+        if(argi + 1 >= argc) break;
+        if(argv[argi][1] == 'i') in_path = argv[++argi];
+        else if(argv[argi][1] == 'o') out_path = argv[++argi];
+        else break;
+    }
+    if(argi + 1 != argc) {
+        fprintf(stderr, "usage: %s [-o out.bin] [-i in.bin] /dev/pts/N\n", argv[0]);
+        return 2;
+    }
+
+    memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+    if(in_path) {
+        FILE *img = fopen(in_path, "rb");
+        if(!img) {
+            perror(in_path);
+            return 1;
+        }
+        size_t got = fread(host_eeprom, 1, sizeof(host_eeprom), img);
+        fclose(img);
+        (void)got;
+    }
+
+    host_uart_fd = open(argv[argi], O_RDWR | O_NOCTTY);
+    if(host_uart_fd < 0) {
+        perror(argv[argi]);
+        return 1;
+    }
+    struct termios tio;
+    if(tcgetattr(host_uart_fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(host_uart_fd, TCSANOW, &tio);
+    }
+
+    /* Idle like check_serial() in PC LINK mode: only LINK_SOF matters here */
+    int fd = host_uart_fd;
+    int sessions = 0;
+    uint8_t c;
+    while(read(fd, &c, 1) == 1) {
+        if(c != LINK_SOF) continue;
+        link_session();
+        sessions++;
+        if(host_uart_fd < 0) break;
+    }
+    close(fd);
+    fprintf(stderr, "gemos_link: %d session(s)\n", sessions);
+
+    if(out_path) {
+        FILE *img = fopen(out_path, "wb");
+        if(!img || fwrite(host_eeprom, 1, sizeof(host_eeprom), img) != sizeof(host_eeprom)) {
+            perror(out_path);
+            return 1;
+        }
+        fclose(img);
+    }
+    return 0;
+}
@@ -0,0 +1,512 @@
+/*********************************************************************************
+ * Project Name : GemOS Host VM Runner
+ * Version      : 1.07
+ * Date         : 2026-10-16
+ * Developers   : yas & Gemini
+ *
+ * Runs a GemOS cartridge slot from an EEPROM image on a Linux PC, headless and
+ * unthrottled. The firmware source is compiled in as-is (host/debug.h stands in
+ * for the WCH SDK), so the VM semantics are exactly those of the device.
+ *
+ * Build (from CH32V006_GemOS):
+ *   gcc -O2 -funsigned-char -I host -o gemos_run host/gemos_run.c
+ *
+ * Usage:
+ *   ./gemos_run [options] 2026_05_03_EEPROM.bin 02
+ *     -n N      Frames to run (default 600)
+ *     -i FILE   Scripted input, one line per step: FRAMES DX DY BUTTONS
+ *               DX/DY = joystick step (-4..4), BUTTONS = any of A B S or -
+ *     -c FILE   Apply a CODE.TXT (TITLE / PAYLOAD lines) to the image first
+ *     -o FILE   Write the final framebuffer as a PBM image
+ *     -l N      List the first N frames that hit the runaway limit (default 10)
+ *     -p N      Print the N hottest command blocks (same counters as the P command)
+ *     -y FILE   Replay an input log (I,L lines as the I command lists them)
+ *     -w FILE   Record the run's input and write it as I,L lines
+ *     -s N      Leave through EXT after frame N (VM snapshot) and launch the slot again
+ *     -e FILE   Leave through EXT at the end and write the EEPROM image (the
+ *               snapshot included) to FILE; a run on that image resumes
+ *     -d        Render every frame and count the OLED pages the page diff would send
+ *     -q        Do not print the framebuffer
+ *
+ * [Change History]
+ * V1.07 - A snapshot header of another GemOS version is reported as a cold
+ * start too.
+ * V1.06 - VM snapshot: -s suspends and resumes in one run, -e keeps the
+ * snapshot in an image for the next run; EEPROM bytes of both launches.
+ * V1.05 - Packed slots (pc_upload.py --pack) run as they are; EEPROM bytes
+ * read at launch and by cache refills are reported.
+ * V1.04 - Code cache report (hit rate, refills per frame), multi-slot
+ * cartridges (PAYLOAD blocks 59+ in -c go to the ID 0xFE slots that follow).
+ * V1.03 - Input log replay (-y) and recording (-w) through the firmware's
+ * in_frame(), so device and host sessions run the same frames.
+ * V1.02 - Per-frame OLED page diff statistics (-d).
+ * V1.01 - Per-block profile (-p), frame budget limit taken from VM_OP_LIMIT,
+ * CALL/RET stack fault report.
+ * V1.00 - Initial runner: slot launch, scripted input, ops/frame statistics,
+ * runaway-limited frame report and final framebuffer dump.
+ *********************************************************************************/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* SysTick is not emulated, so the host keeps the op-count frame budget */
+#define VM_SCHED_TIME 0
+/* Shim I2C1/DMA registers never complete; the OLED is not driven anyway */
+#define OLED_HW_I2C 0
+/* Profile (-p) and input log (-y/-w) need their counters compiled in */
+#define VM_PROF 1
+#define IN_REC 1
+#define main gemos_firmware_main
+#include "../GemOS_006_070.c"
+#undef main
+
+uint8_t host_eeprom[0x10000];
+
+/* --- Scripted Input --- */
+typedef struct {
+    uint32_t frames;
+    int16_t dx;
+    int16_t dy;
+    uint8_t buttons;    // bit0 = A, bit1 = B, bit2 = stick switch
+} input_step_t;
+
+static input_step_t *script = NULL;
+static int script_len = 0;
+
+static bool load_script(const char *path) {
+    FILE *f = fopen(path, "r");
+    if(!f) return false;
+    char line[128];
+    int cap = 0;
+    while(fgets(line, sizeof(line), f)) {
+        char *p = line;
+        while(*p == ' ' || *p == '\t') p++;
+        if(*p == '#' || *p == '\n' || *p == '\r' || *p == 0) continue;
+        unsigned frames;
+        int dx, dy;
+        char btn[8] = "-";
+        if(sscanf(p, "%u %d %d %7s", &frames, &dx, &dy, btn) < 3) continue;
+        if(script_len == cap) {
+            cap = cap ? cap * 2 : 64;
+            script = realloc(script, cap * sizeof(input_step_t));
+        }
+        input_step_t *s = &script[script_len++];
+        s->frames = frames;
+        s->dx = dx;
+        s->dy = dy;
+        s->buttons = 0;
+        for(char *b = btn; *b; b++) {
+            if(*b == 'A' || *b == 'a') s->buttons |= 1;
+            if(*b == 'B' || *b == 'b') s->buttons |= 2;
+            if(*b == 'S' || *b == 's') s->buttons |= 4;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static void apply_input(uint32_t frame) {
+    int16_t dx = 0, dy = 0;
+    uint8_t buttons = 0;
+    uint32_t at = 0;
+    for(int i = 0; i < script_len; i++) {
+        if(frame < at + script[i].frames) {
+            dx = script[i].dx;
+            dy = script[i].dy;
+            buttons = script[i].buttons;
+            break;
+        }
+        at += script[i].frames;
+    }
+    /* Same order as the device main loop: log or replay, then the cursor */
+    in_frame(&dx, &dy, &buttons);
+    vm_in_btn = buttons;
+    vm_in_dx = dx;
+    vm_in_dy = dy;
+    cursor_move(dx, dy);
+}
+
+/* --- Input Log Files (I,L,OFS,HEX lines; anything else is skipped) --- */
+static bool load_input_log(const char *path) {
+    FILE *f = fopen(path, "r");
+    if(!f) return false;
+    char line[256];
+    in_len = 0;
+    while(fgets(line, sizeof(line), f)) {
+        unsigned ofs;
+        int at = 0;
+        if(sscanf(line, "I,L,%4x,%n", &ofs, &at) < 1 || !at || ofs > in_len) continue;   // Gaps are skipped
+        const char *p = line + at;
+        while(isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1]) && ofs < IN_LOG_LEN) {
+            in_log[ofs++] = hex2byte(p[0], p[1]);
+            p += 2;
+        }
+        if(ofs > in_len) in_len = ofs;
+    }
+    fclose(f);
+    return true;
+}
+
+static bool write_input_log(const char *path) {
+    FILE *f = fopen(path, "w");
+    if(!f) return false;
+    for(uint16_t ofs = 0; ofs < in_len; ofs += IN_LINE_BYTES) {
+        fprintf(f, "I,L,%04X,", ofs);
+        for(uint16_t i = ofs; i < in_len && i < ofs + IN_LINE_BYTES; i++) fprintf(f, "%02X", in_log[i]);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    return true;
+}
+
+/* --- CODE.TXT Overlay (same layout as the W and S terminal commands) --- */
+static int hexval(const char *s) {
+    return hex2byte(s[0], s[1]);
+}
+
+static bool apply_code_txt(const char *path) {
+    FILE *f = fopen(path, "r");
+    if(!f) return false;
+    char line[512];
+    while(fgets(line, sizeof(line), f)) {
+        char *parts[8];
+        int n = 0;
+        char *p = line;
+        line[strcspn(line, "\r\n")] = 0;
+        while(n < 8) {
+            parts[n++] = p;
+            p = strchr(p, ',');
+            if(!p) break;
+            *p++ = 0;
+        }
+        if(strcmp(parts[0], "TITLE") == 0 && n >= 4) {
+            uint16_t base = DEV_MEM_START + atoi(parts[1]) * DEV_MEM_SIZE;
+            host_eeprom[base + DEV_ID_OFS] = hexval(parts[2]);
+            size_t len = strlen(parts[3]);
+            for(int i = 0; i < 16; i++) {
+                host_eeprom[base + DEV_LBL_OFS + i] = (i < (int)len) ? parts[3][i] : ' ';
+            }
+        } else if(strcmp(parts[0], "PAYLOAD") == 0 && n >= 6) {
+            int first = atoi(parts[1]);
+            int pat = atoi(parts[2]);
+            int slot = first + pat / VM_BLOCKS;
+            if(slot > 30) continue;
+            if(slot != first) {
+                /* Continuation slot: first slot's label with " +k", same as pc_upload.py */
+                uint16_t cont = DEV_MEM_START + slot * DEV_MEM_SIZE;
+                memcpy(&host_eeprom[cont + DEV_LBL_OFS], &host_eeprom[DEV_MEM_START + first * DEV_MEM_SIZE + DEV_LBL_OFS], 13);
+                host_eeprom[cont + DEV_LBL_OFS + 13] = ' ';
+                host_eeprom[cont + DEV_LBL_OFS + 14] = '+';
+                host_eeprom[cont + DEV_LBL_OFS + 15] = '0' + pat / VM_BLOCKS;
+                host_eeprom[cont + DEV_ID_OFS] = DEV_ID_CONT;
+            }
+            uint16_t base = DEV_MEM_START + slot * DEV_MEM_SIZE + DEV_CMD_OFS + (pat % VM_BLOCKS) * 32;
+            size_t len = strlen(parts[3]);
+            for(int i = 0; i < 8; i++) {
+                host_eeprom[base + i] = (i < (int)len) ? parts[3][i] : ' ';
+            }
+            uint8_t count = hexval(parts[4]);
+            host_eeprom[base + 8] = count;
+            for(int i = 0; i < count && i < 22 && parts[5][i * 2] && parts[5][i * 2 + 1]; i++) {
+                host_eeprom[base + 9 + i] = hexval(&parts[5][i * 2]);
+            }
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+/* --- Framebuffer --- */
+static uint8_t framebuffer[8][128];
+
+static void render_frame() {
+    for(current_page = 0; current_page < 8; current_page++) {
+        memset(oled_buffer, 0, sizeof(oled_buffer));
+        render_vm_page();
+        memcpy(framebuffer[current_page], oled_buffer, 128);
+    }
+}
+
+/* Same page loop as the device main loop with the VM running */
+static void diff_frame() {
+    oled_frame_begin();
+    for(current_page = 0; current_page < 8; current_page++) {
+        memset(oled_buffer, 0, sizeof(oled_buffer));
+        render_vm_page();
+        draw_cursor(mouse_x, mouse_y);
+        if(oled_page_dirty()) oled_stat_pages++;
+    }
+    oled_stat_frames++;
+}
+
+static int fb_pixel(int x, int y) {
+    return (framebuffer[y >> 3][x] >> (y & 7)) & 1;
+}
+
+static void print_framebuffer() {
+    static const char cell[4] = { ' ', '\'', '.', ':' };
+    printf("+");
+    for(int x = 0; x < 128; x++) putchar('-');
+    printf("+\n");
+    for(int y = 0; y < 64; y += 2) {
+        putchar('|');
+        for(int x = 0; x < 128; x++) putchar(cell[fb_pixel(x, y) | (fb_pixel(x, y + 1) << 1)]);
+        printf("|\n");
+    }
+    printf("+");
+    for(int x = 0; x < 128; x++) putchar('-');
+    printf("+\n");
+}
+
+static bool write_pbm(const char *path) {
+    FILE *f = fopen(path, "w");
+    if(!f) return false;
+    fprintf(f, "P1\n128 64\n");
+    for(int y = 0; y < 64; y++) {
+        for(int x = 0; x < 128; x++) fputc(fb_pixel(x, y) ? '1' : '0', f);
+        fputc('\n', f);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool write_image(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if(!f) return false;
+    bool ok = fwrite(host_eeprom, 1, sizeof(host_eeprom), f) == sizeof(host_eeprom);
+    return fclose(f) == 0 && ok;
+}
+
+/* --- Block Profile --- */
+static void print_profile(int top) {
+    uint8_t order[VM_BLOCKS];
+    int n = 0;
+    uint32_t total = 0;
+    for(int b = 0; b < VM_BLOCKS; b++) {
+        if(vm_prof_hits[b] == 0) continue;
+        total += vm_prof_hits[b];
+        int i = n++;
+        while(i > 0 && vm_prof_hits[order[i - 1]] < vm_prof_hits[b]) {
+            order[i] = order[i - 1];
+            i--;
+        }
+        order[i] = b;
+    }
+    printf("Profile : ops per command block%s\n", vm_prof_shift ? " (scaled)" : "");
+    for(int i = 0; i < n && i < top; i++) {
+        int b = order[i];
+        uint8_t blk[VM_PAGE];
+        vm_blk_load(b, blk);
+        printf("  %02d %.8s : %5u %5.1f%% ", b, (const char *)blk,
+               vm_prof_hits[b], 100.0 * vm_prof_hits[b] / total);
+        for(int k = 0; k < 20 * vm_prof_hits[b] / vm_prof_hits[order[0]]; k++) putchar('#');
+        putchar('\n');
+    }
+}
+
+static void usage() {
+    fprintf(stderr, "usage: gemos_run [-n frames] [-i input.txt] [-c CODE.TXT] [-o fb.pbm] [-y log] [-w log] [-l N] [-p N] [-s N] [-e image] [-d] [-q] IMAGE SLOT\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = 600;
+    const char *input_path = NULL;
+    const char *code_path = NULL;
+    const char *pbm_path = NULL;
+    const char *replay_path = NULL;
+    const char *record_path = NULL;
+    const char *image_path = NULL;
+    uint32_t suspend_at = 0;
+    int list_limit = 10;
+    int prof_top = 0;
+    bool quiet = false;
+    bool page_diff = false;
+    int argi = 1;
+    for(; argi < argc && argv[argi][0] == '-'; argi++) {
+        char opt = argv[argi][1];
+        if(opt == 'q') { quiet = true; continue; }
+        if(opt == 'd') { page_diff = true; continue; }
+        if(argi + 1 >= argc) usage();
+        const char *val = argv[++argi];
+        if(opt == 'n') frames = strtoul(val, NULL, 0);
+        else if(opt == 'i') input_path = val;
+        else if(opt == 'c') code_path = val;
+        else if(opt == 'o') pbm_path = val;
+        else if(opt == 'y') replay_path = val;
+        else if(opt == 'w') record_path = val;
+        else if(opt == 'l') list_limit = atoi(val);
+        else if(opt == 'p') prof_top = atoi(val);
+        else if(opt == 's') suspend_at = strtoul(val, NULL, 0);
+        else if(opt == 'e') image_path = val;
+        else usage();
+    }
+    if(argc - argi != 2) usage();
+    int slot = atoi(argv[argi + 1]);
+    if(slot < 0 || slot > 30) {
+        fprintf(stderr, "slot must be 0..30\n");
+        return 2;
+    }
+
+    memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+    FILE *img = fopen(argv[argi], "rb");
+    if(!img) {
+        perror(argv[argi]);
+        return 1;
+    }
+    size_t got = fread(host_eeprom, 1, sizeof(host_eeprom), img);
+    fclose(img);
+    if(got < (size_t)(DEV_MEM_START + (slot + 1) * DEV_MEM_SIZE)) {
+        fprintf(stderr, "image too small for slot %d\n", slot);
+        return 1;
+    }
+    if(code_path && !apply_code_txt(code_path)) {
+        perror(code_path);
+        return 1;
+    }
+    if(input_path && !load_script(input_path)) {
+        perror(input_path);
+        return 1;
+    }
+
+    if(replay_path && !load_input_log(replay_path)) {
+        perror(replay_path);
+        return 1;
+    }
+    if(replay_path && record_path) {
+        fprintf(stderr, "-y and -w cannot be combined\n");
+        return 2;
+    }
+    if((replay_path || record_path) && suspend_at > 0) {
+        fprintf(stderr, "-s ends the input log session, use it without -y / -w\n");
+        return 2;
+    }
+    if(replay_path) in_mode = IN_PLAY_ARM;
+    if(record_path) in_mode = IN_REC_ARM;
+
+    font_load();
+    vm_snap_probe();
+    const uint8_t *snap = &host_eeprom[SNAP_ADDR];
+    bool had_snap = (snap[0] == SNAP_MAGIC && snap[2] == slot);   // Any version
+    vm_launch(slot);
+    if(replay_path && in_mode != IN_PLAY) {
+        fprintf(stderr, "%s: not an input log for slot %02d\n", replay_path, slot);
+        return 1;
+    }
+    printf("Slot %02d : ", slot);
+    const uint8_t *title = &host_eeprom[DEV_MEM_START + slot * DEV_MEM_SIZE + DEV_LBL_OFS];
+    for(int i = 0; i < 16; i++) putchar(isprint(title[i]) ? title[i] : ' ');
+    if(vm_packed) printf("\nCart    : %u blocks, packed in one slot\n", vm_blocks);
+    else printf("\nCart    : %u blocks in %u slot(s)%s\n", vm_blocks, vm_blocks / VM_BLOCKS,
+                vm_running ? "" : " (continuation slot, not an app)");
+    if(had_snap) {
+        printf("Resume  : %s\n", vm_resumed ? "snapshot restored" :
+               snap[1] != SNAP_VER ? "snapshot of another GemOS version, cold start" :
+               "snapshot does not match the cart, cold start");
+    }
+    uint32_t run_bytes0 = eeprom_rd_bytes;
+    printf("Decode  : %u / %u records%s\n", vm_rec_count, VM_REC_MAX, vm_rec_count ? "" : " (per-step decode)");
+    uint32_t snap_len = SNAP_HDR;
+    for(uint8_t k = 0; k < SNAP_PARTS; k++) snap_len += vm_snap_parts[k].n;
+    uint32_t cold_bytes = cart_load_bytes;
+    bool suspended = false;
+
+    uint64_t ops_total = 0;
+    uint32_t ops_min = 0xFFFFFFFF, ops_max = 0, capped = 0, run = 0;
+    uint32_t hist[11] = {0};
+    uint32_t *capped_list = calloc(list_limit > 0 ? list_limit : 1, sizeof(uint32_t));
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(run = 0; run < frames && vm_running; run++) {
+        if(run == suspend_at && suspend_at > 0) {
+            uint32_t b = eeprom_rd_bytes;
+            vm_snap_save();
+            vm_launch(slot);
+            run_bytes0 += eeprom_rd_bytes - b;   // Not refills: counted under Suspend
+            suspended = vm_resumed;
+        }
+        apply_input(run);
+        vm_run_frame();
+        if(page_diff) diff_frame();
+        ops_total += vm_frame_ops;
+        if(vm_frame_ops < ops_min) ops_min = vm_frame_ops;
+        if(vm_frame_ops > ops_max) ops_max = vm_frame_ops;
+        hist[vm_frame_ops >= 100 ? 10 : vm_frame_ops / 10]++;
+        if(vm_frame_capped) {
+            if((int)capped < list_limit) capped_list[capped] = run;
+            capped++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    vm_cache_frame_end();
+    uint32_t run_bytes = eeprom_rd_bytes - run_bytes0;
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    printf("Frames  : %u%s\n", run, vm_running ? "" : " (VM halted)");
+    printf("Host    : %.3f s, %.0f frames/s\n", secs, secs > 0 ? run / secs : 0.0);
+    if(run > 0) {
+        printf("Ops     : %llu total, min %u / avg %.1f / max %u per frame\n",
+               (unsigned long long)ops_total, ops_min, (double)ops_total / run, ops_max);
+    }
+    printf("Ops/frame histogram:\n");
+    for(int i = 0; i < 11; i++) {
+        if(hist[i] == 0) continue;
+        if(i < 10) printf("  %3d-%3d : %u\n", i * 10, i * 10 + 9, hist[i]);
+        else printf("  100     : %u\n", hist[i]);
+    }
+    printf("Runaway : %u frames hit the %d-op limit", capped, VM_OP_LIMIT);
+    for(int i = 0; i < (int)capped && i < list_limit; i++) printf("%s%u", i ? ", " : " (frames ", capped_list[i]);
+    if(capped > 0 && list_limit > 0) printf("%s)", (int)capped > list_limit ? ", ..." : "");
+    printf("\n");
+    if(replay_path) {
+        printf("Replay  : %u frames from %u runs%s\n", in_frames, (in_len - IN_HDR) / 4,
+               in_mode == IN_PLAY ? "" : ", live input after the log ran out");
+    }
+    if(record_path) {
+        printf("Record  : %u frames in %u runs%s\n", in_frames, (in_len - IN_HDR) / 4,
+               in_full ? " (log full, recording stopped)" : "");
+        if(!write_input_log(record_path)) {
+            perror(record_path);
+            return 1;
+        }
+    }
+    printf("Cache   : %u pages, %u lookups, %.1f%% hit, %u refills (%u frames), max %u per frame\n",
+           VM_CACHE_PAGES, vm_cache_lookups,
+           vm_cache_lookups ? 100.0 * (vm_cache_lookups - vm_cache_misses) / vm_cache_lookups : 100.0,
+           vm_cache_misses, vm_cache_stalled, vm_cache_fmiss_max);
+    printf("EEPROM  : %u bytes read at launch, %u while running\n", cold_bytes, run_bytes);
+    if(suspend_at > 0 && run >= suspend_at) {
+        printf("Suspend : EXT after frame %u, %u B snapshot, %s launch read %u B vs %u B cold\n",
+               suspend_at, snap_len, suspended ? "resumed" : "FAILED", cart_load_bytes, cold_bytes);
+    }
+    printf("Last PC : 0x%04X\n", last_vm_pc);
+    if(vm_fault != VM_FAULT_NONE) {
+        printf("Fault   : %s at 0x%04X\n", vm_fault == VM_FAULT_OVF ? "CALL stack overflow" : "RET stack underflow", vm_fault_pc);
+    }
+    if(prof_top > 0) print_profile(prof_top);
+    if(page_diff && oled_stat_frames > 0) {
+        printf("Display : %u of %u pages sent, %.2f per frame (%.1f%% of full refresh)\n",
+               oled_stat_pages, oled_stat_frames * 8, (double)oled_stat_pages / oled_stat_frames,
+               100.0 * oled_stat_pages / (oled_stat_frames * 8));
+    }
+
+    render_frame();
+    if(!quiet) print_framebuffer();
+    if(pbm_path && !write_pbm(pbm_path)) {
+        perror(pbm_path);
+        return 1;
+    }
+    if(image_path) {
+        if(vm_running) vm_snap_save();
+        if(!write_image(image_path)) {
+            perror(image_path);
+            return 1;
+        }
+    }
+    free(capped_list);
+    free(script);
+    return 0;
+}
@@ -0,0 +1,109 @@
+# *********************************************************************************
+# Project Name : GemOS Link Loopback Test
+# Version      : 1.00
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Runs pc_upload.py against host/gemos_link.c (the firmware's link_session())
+# over a pseudo-terminal pair on Linux. Uploads the OTHELLO and B_BREAKER
+# carts plus a random slot, once on a clean line and once with corrupted and
+# dropped frames, and compares the device's EEPROM image with the expected one.
+#
+# Usage (from CH32V006_GemOS):
+#   python3 host/link_test.py
+#
+# [Change History]
+# V1.00 - Initial loopback test.
+# *********************************************************************************
+
+import os
+import random
+import select
+import subprocess
+import sys
+import tempfile
+import time
+import tty
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+sys.dont_write_bytecode = True
+sys.path.insert(0, ROOT)
+import pc_upload as up
+
+
+class PtyPort:
+    """pyserial-like read/write on the master end of a pty, with fault injection."""
+
+    def __init__(self, fd, corrupt=(), drop=()):
+        self.fd = fd
+        self.frames = 0
+        self.corrupt = set(corrupt)   # Host frame numbers to flip one bit in
+        self.drop = set(drop)         # Host frame numbers never to deliver
+
+    def write(self, data):
+        self.frames += 1
+        if self.frames in self.drop:
+            return
+        if self.frames in self.corrupt:
+            data = bytearray(data)
+            data[len(data) // 2] ^= 0x10
+        os.write(self.fd, bytes(data))
+
+    def read(self, n):
+        r, _, _ = select.select([self.fd], [], [], 0.02)
+        return os.read(self.fd, n) if r else b""
+
+
+def run(label, base_img, jobs, corrupt=(), drop=()):
+    exe = os.path.join(tmp, "gemos_link")
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    out = os.path.join(tmp, "out.bin")
+    dev = subprocess.Popen([exe, "-i", base_path, "-o", out, os.ttyname(slave)])
+    time.sleep(0.2)   # Let gemos_link open and configure the pty
+
+    port = PtyPort(master, corrupt, drop)
+    link = up.Link(port, timeout=0.1)
+    expect = bytearray(base_img)
+    t0 = time.monotonic()
+    for addr, data in jobs:
+        link.upload(addr, data)
+        expect[addr:addr + len(data)] = data
+    dt = time.monotonic() - t0
+
+    refused = False
+    try:
+        link.upload(0x0000, b"\x00")   # Font/version area is not writable by frames
+    except IOError:
+        refused = True
+
+    os.close(master)
+    dev.wait(timeout=5)
+    os.close(slave)
+    with open(out, "rb") as f:
+        got = f.read()
+    ok = got == bytes(expect) and refused
+    print(f"{label:10s}: {len(jobs)} slots in {dt:.2f} s, {link.naks} NAK, "
+          f"{link.resent} resent, {'OK' if ok else 'FAIL'}")
+    return ok
+
+
+tmp = tempfile.mkdtemp()
+subprocess.check_call(["gcc", "-O2", "-funsigned-char", "-I", HERE, "-o",
+                       os.path.join(tmp, "gemos_link"), os.path.join(HERE, "gemos_link.c")])
+base_path = os.path.join(ROOT, "2026_05_03_EEPROM.bin")
+with open(base_path, "rb") as f:
+    base_img = f.read().ljust(0x10000, b"\xFF")
+
+jobs = []
+for code in ("OTHELLO/OTHELLO_Code_041.txt", "B_BREAKER/B_BREAKER__Code_030.txt"):
+    slots, _ = up.load_code(os.path.join(ROOT, code), base_img)
+    for slot, img in sorted(slots.items()):
+        jobs.append((up.DEV_MEM_START + slot * up.DEV_MEM_SIZE, bytes(img)))
+rnd = random.Random(16)
+jobs.append((up.DEV_MEM_START + 30 * up.DEV_MEM_SIZE, bytes(rnd.randrange(256) for _ in range(up.DEV_MEM_SIZE))))
+
+ok = run("clean", base_img, jobs)
+ok &= run("faulty", base_img, jobs, corrupt=(5, 17, 18, 40, 77), drop=(9, 30, 31, 60))
+sys.exit(0 if ok else 1)
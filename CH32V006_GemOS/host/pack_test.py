@@ -0,0 +1,86 @@
+# *********************************************************************************
+# Project Name : GemOS Packed Cartridge Test
+# Version      : 1.02
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Writes the OTHELLO and B_BREAKER carts and a two-slot gemc.py cartridge
+# into an EEPROM image, once as plain slots and once through pc_upload.py's
+# packer (the two-slot cart then fits one slot), runs every cart of both
+# images through host/gemos_run.c and checks that the packed ones run
+# exactly like the plain ones: same output, same final screen, and no more
+# EEPROM bytes read at launch. Prints the slot bytes used and the EEPROM
+# bytes read at launch and while running.
+#
+# Usage (from CH32V006_GemOS):
+#   python3 host/pack_test.py
+#
+# [Change History]
+# V1.02 - Packed launch must not read more than the plain launch.
+# V1.01 - Build, run and image helpers from host/cart_fixture.py.
+# V1.00 - Initial test.
+# *********************************************************************************
+
+import os
+import re
+import sys
+
+sys.dont_write_bytecode = True
+import cart_fixture as fx
+import pc_upload as up
+
+REPORT = ("Host", "Cache", "Cart", "EEPROM")   # Lines that differ by design
+
+
+def source():
+    """Two slots: 70 sprite blocks drawn in turn, a loop in the first slot"""
+    body = ["i = 0", "t = s00", "loop {", "map[i] = t", "t += 1", "if t > s69 {", "t = s00", "}",
+            "i += 1", "if i > 127 {", "i = 0", "}", "frame", "}"]
+    return fx.tile_source('app 06 7B "PACK TEST"', ["i", "t"], 70,
+                          lambda k: [(k >> j) & 1 and 0xFF or 0x81 for j in range(8)], body)
+
+
+def gemos_run(image, slot):
+    return fx.gemos_run("-d", "-n", "600", "-i", keys, image, f"{slot:02d}")
+
+
+def image_with(slots, name):
+    img = bytearray(base)
+    for slot, data in slots.items():
+        a = up.DEV_MEM_START + slot * up.DEV_MEM_SIZE
+        img[a:a + up.DEV_MEM_SIZE] = data
+    return fx.write(name, bytes(img))
+
+
+keys = fx.write("keys.txt", fx.KEYS)
+with open(fx.IMAGE, "rb") as f:
+    base = f.read().ljust(0x10000, b"\xFF")
+_, _, gem = fx.compile_cart(source(), "pack_test")
+
+plain = {}
+for code in ("OTHELLO/OTHELLO_Code_041.txt", "B_BREAKER/B_BREAKER__Code_030.txt", gem):
+    slots, _ = up.load_code(os.path.join(fx.ROOT, code), None if code == gem else base)
+    plain.update(slots)
+packed = up.pack_slots(plain)
+raw_img = image_with(plain, "plain.bin")
+packed_img = image_with(packed, "packed.bin")
+
+ok = all(packed[s][up.DEV_ID_OFS] == 0xFF for s in plain if plain[s][up.DEV_ID_OFS] == up.DEV_ID_CONT)
+for slot in sorted(s for s in plain if plain[s][up.DEV_ID_OFS] != up.DEV_ID_CONT):
+    out_a, scr_a = gemos_run(raw_img, slot)
+    out_b, scr_b = gemos_run(packed_img, slot)
+    same = ([l for l in out_a.splitlines() if not l.startswith(REPORT)] ==
+            [l for l in out_b.splitlines() if not l.startswith(REPORT)] and scr_a == scr_b)
+    span = 1
+    while slot + span in plain and plain[slot + span][up.DEV_ID_OFS] == up.DEV_ID_CONT:
+        span += 1
+    used = len(packed[slot].rstrip(b"\xFF"))
+    a = re.search(r"EEPROM  : (\d+) bytes read at launch, (\d+)", out_a)
+    b = re.search(r"EEPROM  : (\d+) bytes read at launch, (\d+)", out_b)
+    good = (same and "packed in one slot" in out_b and "Fault" not in out_b and a and b
+            and int(b.group(1)) <= int(a.group(1)))
+    print(f"Slot {slot:02d}   : {span * up.DEV_MEM_SIZE} -> {used} bytes, "
+          f"launch {a.group(1) if a else '?'} -> {b.group(1) if b else '?'} B, "
+          f"running {a.group(2) if a else '?'} -> {b.group(2) if b else '?'} B, {'OK' if good else 'FAIL'}")
+    ok &= bool(good)
+sys.exit(0 if ok else 1)
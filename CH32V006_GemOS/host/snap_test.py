@@ -0,0 +1,105 @@
+# *********************************************************************************
+# Project Name : GemOS VM Snapshot Test
+# Version      : 1.02
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Runs the OTHELLO and B_BREAKER carts and a two-slot gemc.py cart through
+# host/gemos_run.c once straight and once left through EXT part way and
+# launched again (-s), and checks that the resumed run ends with the same
+# screen and PC. Then keeps a snapshot in an image (-e), resumes it in a
+# second run, and checks that a snapshot whose body or cartridge changed
+# falls back to a cold start.
+#
+# Usage (from CH32V006_GemOS):
+#   python3 host/snap_test.py
+#
+# [Change History]
+# V1.02 - Stale snapshots must report a cold start and match a cold run of the
+# same image (the renamed one for a title change).
+# V1.01 - Build, run and image helpers from host/cart_fixture.py.
+# V1.00 - Initial test.
+# *********************************************************************************
+
+import os
+import re
+import sys
+
+sys.dont_write_bytecode = True
+import cart_fixture as fx
+from cart_fixture import gemos_run
+
+SNAP_ADDR = 0x0480   # GemOS_006_070.c
+SNAP_HDR = 7
+
+
+def source():
+    """Two slots: a subroutine fills the map from tiles in the second slot"""
+    body = ["sub put {", "map[i] = t", "t += 1", "if t > s69 {", "t = s00", "}", "}",
+            "i = 0", "t = s00", "n = 0", "loop {", "call put", "i += 1", "if i > 127 {", "i = 0",
+            "n += 1", "}", "frame", "}"]
+    return fx.tile_source('app 06 7B "SNAP TEST"', ["i", "t", "n"], 70,
+                          lambda k: [(k * 29 + j * 7) & 0xFF for j in range(8)], body)
+
+
+def last_pc(out):
+    return re.search(r"Last PC : (\S+)", out).group(1)
+
+
+keys = fx.write("keys.txt", fx.KEYS + "200 1 0 A\n")
+image = fx.IMAGE
+_, _, code = fx.compile_cart(source(), "snap_test")
+
+ok = True
+carts = (("OTHELLO", [], "02"), ("B_BREAKER", [], "01"), ("two-slot", ["-c", code], "06"))
+for name, opts, slot in carts:
+    base_out, base_scr = gemos_run("-n", "600", "-i", keys, *opts, image, slot)
+    for at in (1, 137, 300):
+        out, scr = gemos_run("-n", "600", "-i", keys, "-s", str(at), *opts, image, slot)
+        m = re.search(r"Suspend : .* (\d+) B snapshot, resumed launch read (\d+) B vs (\d+) B cold", out)
+        good = m is not None and scr == base_scr and last_pc(out) == last_pc(base_out)
+        if at == 300:
+            print(f"{name:10s}: resumed at frames 1, 137, 300, {m.group(1) if m else '?'} B snapshot, "
+                  f"launch {m.group(3) if m else '?'} B cold / {m.group(2) if m else '?'} B resumed, "
+                  f"{'OK' if good else 'FAIL'}")
+        elif not good:
+            print(f"{name:10s}: resumed at frame {at}, FAIL")
+        ok &= good
+
+# Across runs: the snapshot lives in the image until it is used
+saved = os.path.join(fx.tmp, "saved.bin")
+straight, straight_scr = gemos_run("-n", "500", image, "01")
+gemos_run("-n", "200", "-e", saved, image, "01")
+out, scr = gemos_run("-n", "300", saved, "01")
+good = "snapshot restored" in out and scr == straight_scr and last_pc(out) == last_pc(straight)
+print(f"{'image':10s}: {'OK' if good else 'FAIL'}")
+ok &= good
+
+with open(saved, "rb") as f:
+    img = bytearray(f.read())
+stale = []
+torn = bytearray(img)
+torn[SNAP_ADDR + SNAP_HDR + 100] ^= 0x01
+stale.append(("torn", torn, "01"))
+ver = bytearray(img)
+ver[SNAP_ADDR + 1] ^= 0xFF
+stale.append(("version", ver, "01"))
+TITLE = 0x0800 + 1 * 0x0800 + 3   # A title byte of slot 01
+title = bytearray(img)
+title[TITLE] ^= 0x20
+stale.append(("title", title, "01"))
+_, cold_scr = gemos_run("-n", "300", image, "01")
+with open(image, "rb") as f:
+    renamed = bytearray(f.read())
+renamed[TITLE] ^= 0x20   # The same rename without a snapshot
+_, renamed_scr = gemos_run("-n", "300", fx.write("renamed.bin", bytes(renamed)), "01")
+for label, data, slot in stale:
+    out, scr = gemos_run("-n", "300", fx.write(label + ".bin", bytes(data)), slot)
+    good = "cold start" in out and scr == (renamed_scr if label == "title" else cold_scr)
+    print(f"{label:10s}: stale snapshot, {'cold start' if good else 'FAIL'}")
+    ok &= good
+out, _ = gemos_run("-n", "300", saved, "02")
+good = "Resume  :" not in out
+print(f"{'other slot':10s}: {'not resumed' if good else 'FAIL'}")
+ok &= good
+sys.exit(0 if ok else 1)
@@ -0,0 +1,351 @@
+# *********************************************************************************
+# Project Name : GemOS Bulk Uploader
+# Version      : 1.03
+# Date         : 2026-10-16
+# Developers   : yas & Gemini
+#
+# Builds whole 2 KB slot images from CODE.TXT (same format as pc_link.py) and
+# streams them over the binary link (GemOS V0.86+, PC LINK mode): CRC-16
+# frames of 64 bytes, a window of frames in flight, go-back-N on NAK or
+# timeout and a CRC read-back of every slot at the end.
+#
+# Usage:
+#   python pc_upload.py [-p COM7] [-b base.bin] [--pack] [CODE.TXT]
+#
+# [Change History]
+# V1.03 - Packed format 2 (GemOS V0.95+): one entry per block in block order, a
+# repeated block is 0xFF and the number of its first copy, so launch reads the
+# blocks as one stream.
+# V1.02 - --pack writes each cartridge as one packed slot (GemOS V0.93+):
+# command blocks as LZ token streams behind an offset table, continuation
+# slots freed.
+# V1.01 - PAYLOAD blocks 59 and up go to the following slots, which get
+# ID 0xFE (continuation of a multi-slot cartridge, GemOS V0.91+).
+# V1.00 - Initial bulk uploader.
+# *********************************************************************************
+
+import argparse
+import os
+import sys
+import time
+
+# 接続設定
+COM_PORT = 'COM7'
+BAUD_RATE = 115200
+
+# Frame layout of link_session() in GemOS_006_070.c
+LINK_SOF = 0xA5
+LINK_OPEN = 0x01
+LINK_WRITE = 0x02
+LINK_CLOSE = 0x03
+LINK_ACK = 0x80
+LINK_NAK = 0x81
+LINK_ERR = 0x82
+LINK_DATA_MAX = 64
+LINK_WINDOW = 2      # Frames in flight; more would overrun the 64-byte RX ring
+LINK_TIMEOUT = 0.3   # Seconds without a reply before the window is resent
+LINK_RETRIES = 8
+
+DEV_MEM_START = 0x0800
+DEV_MEM_SIZE = 0x0800
+DEV_ID_OFS = 0x0010
+DEV_CMD_OFS = 0x00A0
+DEV_ID_CONT = 0xFE
+BLOCKS = 59          # Command blocks per slot
+SPAN_MAX = 4         # Slots per cartridge (VM_SPAN_MAX)
+PACK_MAGIC = 0x9C    # DEV_PACK_MAGIC / DEV_PACK_VER in GemOS_006_070.c
+PACK_VER = 0x02
+PACK_DUP = 0xFF      # DEV_PACK_DUP: entry that repeats an earlier block
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def make_frame(ftype, seq, payload=b""):
+    body = bytes([ftype, seq & 0xFF, len(payload)]) + bytes(payload)
+    crc = crc16(body)
+    return bytes([LINK_SOF]) + body + bytes([crc >> 8, crc & 0xFF])
+
+
+def load_code(path, base=None):
+    """CODE.TXT -> ({slot: bytearray(2048)}, (major, minor) or None)"""
+    slots = {}
+    appver = None
+    conts = {}   # Continuation slot -> (first slot, k)
+
+    def slot_image(slot):
+        if slot not in slots:
+            if base is not None:
+                ofs = DEV_MEM_START + slot * DEV_MEM_SIZE
+                slots[slot] = bytearray(base[ofs:ofs + DEV_MEM_SIZE])
+            else:
+                slots[slot] = bytearray([0xFF] * DEV_MEM_SIZE)
+        return slots[slot]
+
+    with open(path, "r", encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            parts = line.split(",")
+            if parts[0] == "TITLE":
+                img = slot_image(int(parts[1]))
+                img[0:16] = parts[3].ljust(16, ' ')[:16].encode()
+                img[DEV_ID_OFS] = int(parts[2], 16)
+            elif parts[0] == "PAYLOAD":
+                first, pat = int(parts[1]), int(parts[2])
+                slot = first + pat // BLOCKS
+                if slot != first:
+                    conts[slot] = (first, pat // BLOCKS)
+                img = slot_image(slot)
+                ofs = DEV_CMD_OFS + (pat % BLOCKS) * 32
+                count = int(parts[4], 16)
+                payload = bytes.fromhex(parts[5])[:min(count, 22)]
+                img[ofs:ofs + 8] = parts[3].ljust(8, ' ')[:8].encode()
+                img[ofs + 8] = count
+                img[ofs + 9:ofs + 9 + len(payload)] = payload
+            elif parts[0] == "APPVER":
+                appver = (int(parts[1]), int(parts[2]))
+    for slot, (first, k) in conts.items():
+        img = slot_image(slot)
+        img[0:16] = bytes(slot_image(first)[0:13]) + (" +%d" % k).encode()
+        img[DEV_ID_OFS] = DEV_ID_CONT
+    return slots, appver
+
+
+def block_bytes(blk):
+    """The part of a 32-byte command block the VM reads: label, count, payload."""
+    return bytes(blk[:9 + min(blk[8], 22)])
+
+
+def unpack_block(stream):
+    """vm_unpack() in GemOS_006_070.c: token stream -> block_bytes()"""
+    out = bytearray()
+    i = 0
+    end = 9
+    while len(out) < end:
+        c = stream[i]
+        i += 1
+        k = c + 1 if c < 0x20 else (c - 0x1F if c < 0x40 else c >> 5)
+        d = (c & 0x1F) + 1
+        for _ in range(k):
+            if len(out) >= end:
+                break
+            n = len(out)
+            if c < 0x20:
+                out.append(stream[i])
+                i += 1
+            elif c < 0x40:
+                out.append(out[n - 1] if n > 0 else 0x20)
+            else:
+                out.append(out[n - d] if d <= n else 0x20)
+            if len(out) == 9:
+                end = 9 + min(out[8], 22)
+    return bytes(out)
+
+
+def pack_block(raw):
+    """Shortest token stream for block_bytes() raw (dynamic programming)."""
+    n = len(raw)
+    best = [None] * (n + 1)   # best[i] = (cost, tokens) for raw[i:]
+    best[n] = (0, b"")
+    for i in range(n - 1, -1, -1):
+        cands = []
+        for k in range(1, min(32, n - i) + 1):   # Literals
+            cands.append((1 + k + best[i + k][0], bytes([k - 1]) + raw[i:i + k], i + k))
+        prev = raw[i - 1] if i > 0 else 0x20
+        k = 0
+        while k < 32 and i + k < n and raw[i + k] == prev:   # Run of the last byte
+            k += 1
+            cands.append((1 + best[i + k][0], bytes([0x1F + k]), i + k))
+        for d in range(1, min(32, i) + 1):   # Copy, may overlap itself
+            k = 0
+            while k < 7 and i + k < n and raw[i + k] == raw[i + k - d]:
+                k += 1
+                if k >= 2:
+                    cands.append((1 + best[i + k][0], bytes([(k << 5) | (d - 1)]), i + k))
+        cost, tok, j = min(cands, key=lambda c: c[0])
+        best[i] = (cost, tok + best[j][1])
+    stream = best[0][1]
+    assert unpack_block(stream) == raw
+    return stream
+
+
+def pack_cart(head, blocks):
+    """First 0xA0 bytes of a slot and its 32-byte command blocks -> packed 2 KB slot"""
+    n = len(blocks)
+    if not 0 < n <= BLOCKS * SPAN_MAX:
+        raise ValueError(f"{n} blocks cannot be packed")
+    img = bytearray(head[:DEV_CMD_OFS]) + bytes([PACK_MAGIC, PACK_VER, n]) + bytes(2 * n)
+    seen = {}   # Block bytes -> first block with them
+    for b, blk in enumerate(blocks):
+        raw = block_bytes(blk)
+        ofs = DEV_CMD_OFS + 3 + 2 * b
+        img[ofs:ofs + 2] = bytes([len(img) >> 8, len(img) & 0xFF])
+        if raw in seen:
+            img += bytes([PACK_DUP, seen[raw]])   # A stream never starts with a copy
+        else:
+            seen[raw] = b
+            img += pack_block(raw)
+    if len(img) > DEV_MEM_SIZE:
+        raise ValueError(f"packed cartridge needs {len(img)} bytes, a slot has {DEV_MEM_SIZE}")
+    return img.ljust(DEV_MEM_SIZE, b"\xFF")
+
+
+def pack_slots(slots):
+    """load_code() slots -> each cartridge in one packed slot, continuation slots freed"""
+    out = {}
+    for slot in sorted(slots):
+        img = slots[slot]
+        if img[DEV_ID_OFS] == DEV_ID_CONT:
+            continue
+        span = 1
+        while span < SPAN_MAX and slots.get(slot + span, b"\xFF" * DEV_MEM_SIZE)[DEV_ID_OFS] == DEV_ID_CONT:
+            out[slot + span] = bytearray(b"\xFF" * DEV_MEM_SIZE)
+            span += 1
+        blocks = []
+        for s in range(slot, slot + span):
+            blocks += [slots[s][DEV_CMD_OFS + 32 * b:DEV_CMD_OFS + 32 * b + 32] for b in range(BLOCKS)]
+        out[slot] = pack_cart(img, blocks)
+    return out
+
+
+class Link:
+    """Host end of link_session(). port needs read(n) with a timeout and write(b)."""
+
+    def __init__(self, port, window=LINK_WINDOW, timeout=LINK_TIMEOUT):
+        self.port = port
+        self.window = window
+        self.timeout = timeout
+        self.rx = bytearray()
+        self.resent = 0
+        self.naks = 0
+
+    def read_frame(self, timeout):
+        """Next valid device frame (type, seq, payload), or None on timeout."""
+        end = time.monotonic() + timeout
+        while True:
+            while self.rx and self.rx[0] != LINK_SOF:
+                del self.rx[0]   # Terminal text or line noise
+            if len(self.rx) >= 4 and len(self.rx) >= 6 + self.rx[3]:
+                n = self.rx[3]
+                body = bytes(self.rx[1:4 + n])
+                crc = (self.rx[4 + n] << 8) | self.rx[5 + n]
+                if crc == crc16(body):
+                    del self.rx[:6 + n]
+                    return body[0], body[1], body[3:]
+                del self.rx[0]
+                continue
+            if time.monotonic() >= end:
+                return None
+            self.rx += self.port.read(64)
+
+    def request(self, ftype, seq, payload=b""):
+        """Send one frame and wait for its ACK (OPEN / CLOSE)."""
+        for _ in range(LINK_RETRIES):
+            self.port.write(make_frame(ftype, seq, payload))
+            end = time.monotonic() + self.timeout * 4
+            while time.monotonic() < end:
+                reply = self.read_frame(end - time.monotonic())
+                if reply is None:
+                    break
+                if reply[0] == LINK_ERR:
+                    raise IOError(f"device refused frame {seq}")
+                if reply[0] == LINK_ACK and reply[1] == seq & 0xFF:
+                    return reply[2]
+            self.resent += 1
+        raise IOError(f"no ACK for frame {seq}")
+
+    def upload(self, addr, data):
+        """Write data at EEPROM address addr, then check it by CRC read-back."""
+        chunks = [data[i:i + LINK_DATA_MAX] for i in range(0, len(data), LINK_DATA_MAX)]
+        self.rx.clear()
+        self.request(LINK_OPEN, 0)
+        base = 0       # Oldest frame not ACKed (frame i has seq i + 1)
+        nxt = 0        # Next frame to send
+        retries = 0
+        while base < len(chunks):
+            while nxt < len(chunks) and nxt - base < self.window:
+                a = addr + nxt * LINK_DATA_MAX
+                self.port.write(make_frame(LINK_WRITE, nxt + 1, bytes([a >> 8, a & 0xFF]) + chunks[nxt]))
+                nxt += 1
+            reply = self.read_frame(self.timeout)
+            if reply is None:
+                retries += 1
+                if retries > LINK_RETRIES:
+                    raise IOError(f"no reply at frame {base + 1}")
+                self.resent += nxt - base
+                nxt = base
+                continue
+            ftype, seq, _ = reply
+            k = (seq - 1 - base) & 0xFF   # Frames after base that this reply names
+            if ftype == LINK_ACK and k < nxt - base:
+                base += k + 1
+                retries = 0
+            elif ftype == LINK_NAK and k <= nxt - base:
+                self.naks += 1
+                base += k
+                self.resent += nxt - base
+                nxt = base
+            elif ftype == LINK_ERR:
+                raise IOError(f"device refused frame {seq}")
+        res = self.request(LINK_CLOSE, len(chunks) + 1,
+                           bytes([addr >> 8, addr & 0xFF, len(data) >> 8, len(data) & 0xFF]))
+        if len(res) != 2 or ((res[0] << 8) | res[1]) != crc16(data):
+            raise IOError(f"read-back CRC mismatch at 0x{addr:04X}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="GemOS bulk slot uploader")
+    ap.add_argument("code", nargs="?", default="CODE.TXT")
+    ap.add_argument("-p", "--port", default=COM_PORT)
+    ap.add_argument("-b", "--base", help="EEPROM dump that fills the bytes CODE.TXT does not set")
+    ap.add_argument("--pack", action="store_true", help="write each cartridge as one packed slot")
+    args = ap.parse_args()
+
+    if not os.path.exists(args.code):
+        print(f"Error: {args.code} not found.")
+        return 1
+    base = None
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read().ljust(0x10000, b"\xFF")
+    slots, appver = load_code(args.code, base)
+    if args.pack:
+        slots = pack_slots(slots)
+
+    import serial
+    try:
+        ser = serial.Serial(args.port, BAUD_RATE, timeout=0.02)
+        time.sleep(2)
+        ser.reset_input_buffer()
+        print("--- Connected to GemOS ---")
+        link = Link(ser)
+        t0 = time.monotonic()
+        for slot in sorted(slots):
+            t = time.monotonic()
+            link.upload(DEV_MEM_START + slot * DEV_MEM_SIZE, bytes(slots[slot]))
+            print(f"Slot {slot:02d} : {DEV_MEM_SIZE} bytes in {time.monotonic() - t:.2f} s")
+        dt = time.monotonic() - t0
+        print(f"{len(slots) * DEV_MEM_SIZE / dt / 1024:.1f} kB/s, {link.naks} NAK, {link.resent} frames resent")
+        if appver:
+            # Version bytes sit below the slot area, so they go through the V command
+            ser.write(f"V,{appver[0]:02X},{appver[1]:02X}\r\n".encode())
+            time.sleep(0.5)
+            print(ser.read_all().decode(errors="replace").strip())
+        ser.close()
+        print("--- Transfer Complete ---")
+    except Exception as e:
+        print(f"Error: {e}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())